@@ -0,0 +1,19 @@
+# Writes OUT with UDON_BUILD_ID, a hash of every core source and header.
+# cache2.cpp stores it in compiled modules so a module is only loaded by the
+# build that wrote it. OUT is left alone when the hash has not changed.
+file(GLOB files ${CORE_DIR}/*.cpp ${CORE_DIR}/*.h)
+list(SORT files)
+set(all "")
+foreach(f ${files})
+    file(SHA256 ${f} h)
+    string(APPEND all ${h})
+endforeach()
+string(SHA256 id "${all}")
+string(SUBSTRING ${id} 0 16 id)
+set(content "#define UDON_BUILD_ID 0x${id}ull\n")
+if(EXISTS ${OUT})
+    file(READ ${OUT} old)
+endif()
+if(NOT "${old}" STREQUAL "${content}")
+    file(WRITE ${OUT} "${content}")
+endif()
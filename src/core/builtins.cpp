@@ -113,7 +113,7 @@ static std::string to_json(const UdonValue& v)
 	switch (v.type)
 	{
 		case UdonValue::Type::String:
-			return "\"" + json_escape(v.string_value) + "\"";
+			return "\"" + json_escape(v.string_value()) + "\"";
 		case UdonValue::Type::Int:
 			return std::to_string(v.int_value);
 		case UdonValue::Type::Float:
@@ -128,18 +128,22 @@ static std::string to_json(const UdonValue& v)
 		{
 			if (!v.array_map)
 				return "null";
+			const bool set = v.array_map->kind == UdonValue::ManagedArray::Kind::Set;
 			std::ostringstream ss;
-			ss << "{";
+			ss << (set ? "[" : "{");
 			bool first = true;
 			array_foreach(v, [&](const UdonValue& k, const UdonValue& val)
 			{
 				if (!first)
 					ss << ",";
 				first = false;
-				ss << "\"" << json_escape(value_to_string(k)) << "\":" << to_json(val);
+				if (set)
+					ss << to_json(val);
+				else
+					ss << "\"" << json_escape(value_to_string(k)) << "\":" << to_json(val);
 				return true;
 			});
-			ss << "}";
+			ss << (set ? "]" : "}");
 			return ss.str();
 		}
 		case UdonValue::Type::None:
@@ -148,6 +152,13 @@ static std::string to_json(const UdonValue& v)
 	}
 }
 
+// union and intersection take two sets or two maps.
+static bool same_kind_tables(UdonArgs positional)
+{
+	return positional.size() == 2 && array_is_table(positional[0]) && array_is_table(positional[1]) &&
+		positional[0].array_map->kind == positional[1].array_map->kind;
+}
+
 static std::string url_encode(const std::string& s)
 {
 	std::ostringstream escaped;
@@ -527,6 +538,7 @@ struct JsonParser
 {
 	const std::string& s;
 	size_t pos = 0;
+	std::unordered_map<std::string, UdonValue> keys; // one string per distinct object key of this document
 
 	JsonParser(const std::string& str) : s(str) {}
 
@@ -654,7 +666,7 @@ struct JsonParser
 			UdonValue val;
 			if (!parse_value(val))
 				return false;
-			array_set(out, std::to_string(idx++), val);
+			array_set_at(out, idx++, val);
 			skip_ws();
 			if (pos < s.size() && s[pos] == ',')
 			{
@@ -695,7 +707,8 @@ struct JsonParser
 			UdonValue val;
 			if (!parse_value(val))
 				return false;
-			array_set(out, key.string_value, val);
+			auto shared = keys.emplace(key.string_value(), key).first;
+			array_set(out, shared->second, val);
 			skip_ws();
 			if (pos < s.size() && s[pos] == ',')
 			{
@@ -746,19 +759,19 @@ void register_builtins(UdonInterpreter* interp)
 		});
 	};
 
-	interp->register_function("array", "values:any...", "array", [](UdonInterpreter* interp, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation&)
+	interp->register_function("array", "values:any...", "array", [](UdonInterpreter* interp, UdonArgs positional, UdonValue& out, CodeLocation&)
 	{
 		out.type = UdonValue::Type::Array;
 		out.array_map = interp->allocate_array();
 		int idx = 0;
 		for (const auto& v : positional)
 		{
-			array_set(out, std::to_string(idx++), v);
+			array_set_at(out, idx++, v);
 		}
 		return true;
 	});
 
-	interp->register_function("__object_literal", "", "array", [](UdonInterpreter* interp, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("__object_literal", "", "array", [](UdonInterpreter* interp, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.empty())
 		{
@@ -795,17 +808,21 @@ void register_builtins(UdonInterpreter* interp)
 		for (s64 i = 0; i < count; i++)
 		{
 			const UdonValue& key = positional[static_cast<size_t>(count + i)];
-			const UdonValue& UdonValue = positional[static_cast<size_t>(i)];
+			const UdonValue& value = positional[static_cast<size_t>(i)];
 
-			std::string key_str = key_from_value(key);
-
-			array_set(out, key_str, UdonValue);
+			// Literal keys arrive as interned constants; keep them, so every
+			// object from this literal shares its key strings. Computed keys
+			// are stored as they are rather than interned for good.
+			if (key.type == UdonValue::Type::String)
+				array_set(out, key, value);
+			else
+				array_set(out, key_from_value(key), value);
 		}
 
 		return true;
 	});
 
-	interp->register_function("print", "values:any...", "none", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation&)
+	interp->register_function("print", "values:any...", "none", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation&)
 	{
 		std::ostringstream ss;
 		bool first = true;
@@ -821,7 +838,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("puts", "values:any...", "none", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation&)
+	interp->register_function("puts", "values:any...", "none", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation&)
 	{
 		std::ostringstream ss;
 		for (const auto& v : positional)
@@ -853,6 +870,15 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
+	interp->register_function("__profile_opcodes", "enabled?:bool", "none", [](UdonInterpreter* interp, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation&)
+	{
+		interp->stats.profile_opcodes2 = positional.empty() || is_truthy(positional[0]);
+		if (interp->stats.profile_opcodes2 && interp->stats.opcode2_counts.size() < kOpcode2Count)
+			interp->stats.opcode2_counts.assign(kOpcode2Count, 0);
+		out = make_none();
+		return true;
+	});
+
 	interp->register_function("__gc_stats", "", "array", [](UdonInterpreter* interp, const std::vector<UdonValue>&, UdonValue& out, CodeLocation&)
 	{
 		out = make_array();
@@ -874,6 +900,17 @@ void register_builtins(UdonInterpreter* interp)
 		array_set(out, "active_value_root_sets", make_int(static_cast<s64>(interp->active_value_roots.size())));
 		array_set(out, "gc_runs", make_int(static_cast<s64>(interp->gc_runs)));
 		array_set(out, "gc_ms", make_int(static_cast<s64>(interp->gc_time_ms)));
+		array_set(out, "gc_auto_runs", make_int(static_cast<s64>(interp->stats.gc_auto_runs)));
+		array_set(out, "gc_deferred", make_int(static_cast<s64>(interp->stats.gc_deferred)));
+		array_set(out, "gc_alloc_debt", make_int(static_cast<s64>(interp->stats.gc_alloc_debt)));
+		array_set(out, "gc_debt_limit", make_int(static_cast<s64>(interp->gc_debt_limit)));
+		array_set(out, "gc_minor_runs", make_int(static_cast<s64>(interp->stats.gc_minor_runs)));
+		array_set(out, "gc_major_runs", make_int(static_cast<s64>(interp->stats.gc_major_runs)));
+		array_set(out, "gc_old_objects", make_int(static_cast<s64>(interp->old_environments + interp->old_arrays + interp->old_functions)));
+		array_set(out, "gc_promoted", make_int(static_cast<s64>(interp->stats.gc_promoted)));
+		array_set(out, "gc_last_pause_us", make_int(static_cast<s64>(interp->stats.gc_last_pause_us)));
+		array_set(out, "gc_max_pause_us", make_int(static_cast<s64>(interp->stats.gc_max_pause_us)));
+		array_set(out, "pool_capacity", make_int(static_cast<s64>(interp->environment_pool.capacity() + interp->array_pool.capacity() + interp->function_pool.capacity())));
 #if !UDON_USE_VM2
 		for (size_t i = 0; i < static_cast<size_t>(Opcode::OPCODE_MAX); ++i)
 		{
@@ -900,7 +937,7 @@ void register_builtins(UdonInterpreter* interp)
 	interp->register_function("globals", "", "array", [](UdonInterpreter* interp, const std::vector<UdonValue>&, UdonValue& out, CodeLocation&)
 	{
 		out = make_array();
-		for (const auto& kv : interp->globals)
+		for (const auto& kv : interp->global_values())
 			array_set(out, kv.first, kv.second);
 		return true;
 	});
@@ -912,7 +949,7 @@ void register_builtins(UdonInterpreter* interp)
 			interp->builtins[alias] = it->second;
 	};
 
-	interp->register_function("keys", "arr:any", "array", [](UdonInterpreter* interp, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("keys", "arr:any", "array", [](UdonInterpreter* interp, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.empty())
 		{
@@ -955,8 +992,8 @@ void register_builtins(UdonInterpreter* interp)
 		}
 		else if (positional[0].type == UdonValue::Type::String)
 		{
-			for (size_t i = 0; i < positional[0].string_value.size(); ++i)
-				array_set(out, std::to_string(idx++), make_string(std::to_string(i)));
+			for (size_t i = 0; i < positional[0].string_value().size(); ++i)
+				array_set_at(out, idx++, make_string(std::to_string(i)));
 		}
 		else
 		{
@@ -999,7 +1036,7 @@ void register_builtins(UdonInterpreter* interp)
 		if (get_opt("keep_keys", opt))
 			keep_keys = is_truthy(opt);
 		if (get_opt("by", opt) && opt.type == UdonValue::Type::String)
-			by_key = (opt.string_value == "key");
+			by_key = (opt.string_value() == "key");
 		if (get_opt("key", opt))
 		{
 			if (opt.type != UdonValue::Type::Function || !opt.function)
@@ -1023,6 +1060,7 @@ void register_builtins(UdonInterpreter* interp)
 		std::vector<Entry, TypedArena<Entry>> entries((TypedArena<Entry>(&interp->scratch_arena)));
 		entries.reserve(array_length(positional[0]));
 		size_t original_idx = 0;
+		std::vector<UdonValue> key_args(1);
 		array_foreach(positional[0], [&](const UdonValue& k, const UdonValue& v)
 		{
 			Entry e;
@@ -1033,14 +1071,13 @@ void register_builtins(UdonInterpreter* interp)
 			UdonValue base = by_key ? k : v;
 			if (has_key_fn)
 			{
-				std::vector<UdonValue> args;
-				args.push_back(base);
+				key_args[0] = base;
 				UdonValue key_out;
-				CodeLocation call_err = interp->invoke_function(key_fn, args, key_out);
+				CodeLocation call_err = interp->invoke_function(key_fn, key_args, key_out);
 				if (call_err.has_error)
 				{
 					err = call_err;
-					return true;
+					return false;
 				}
 				e.sort_value = key_out;
 			}
@@ -1051,6 +1088,8 @@ void register_builtins(UdonInterpreter* interp)
 			entries.push_back(e);
 			return true;
 		});
+		if (err.has_error) // a failed key function fails the call, however deep it failed
+			return false;
 
 		std::sort(entries.begin(), entries.end(), [reverse](const Entry& a, const Entry& b)
 		{
@@ -1067,7 +1106,7 @@ void register_builtins(UdonInterpreter* interp)
 			if (keep_keys)
 				array_set(out, e.key, e.value);
 			else
-				array_set(out, std::to_string(i), e.value);
+				array_set_at(out, static_cast<s64>(i), e.value);
 		}
 		return true;
 	});
@@ -1123,7 +1162,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("array_get", "arr:any, key:any", "any", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("array_get", "arr:any, key:any", "any", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() < 2)
 		{
@@ -1143,8 +1182,8 @@ void register_builtins(UdonInterpreter* interp)
 			try
 			{
 				const s64 idx = std::stoll(key_str);
-				if (idx >= 0 && static_cast<size_t>(idx) < positional[0].string_value.size())
-					out = make_string(std::string(1, positional[0].string_value[static_cast<size_t>(idx)]));
+				if (idx >= 0 && static_cast<size_t>(idx) < positional[0].string_value().size())
+					out = make_string(std::string(1, positional[0].string_value()[static_cast<size_t>(idx)]));
 				else
 					out = make_none();
 			}
@@ -1265,7 +1304,7 @@ void register_builtins(UdonInterpreter* interp)
 			err.opt_error_message = "dl_open expects a single string path";
 			return true;
 		}
-		std::string path = positional[0].string_value;
+		std::string path = positional[0].string_value();
 		void* handle = dlopen(path.c_str(), RTLD_NOW);
 		if (!handle)
 		{
@@ -1318,7 +1357,7 @@ void register_builtins(UdonInterpreter* interp)
 				err.opt_error_message = "dl_call: invalid handle";
 				return true;
 			}
-			std::string sig_text = symbol_val.string_value;
+			std::string sig_text = symbol_val.string_value();
 			std::string sym_name = sig_text;
 			std::vector<std::string> arg_types;
 			std::string ret_type = "float";
@@ -1533,7 +1572,7 @@ void register_builtins(UdonInterpreter* interp)
 			return true;
 		}
 
-		std::string path = positional[0].string_value;
+		std::string path = positional[0].string_value();
 		std::ifstream file(path, std::ios::binary);
 		if (!file)
 		{
@@ -1547,8 +1586,9 @@ void register_builtins(UdonInterpreter* interp)
 
 		std::unique_ptr<UdonInterpreter> sub = std::make_unique<UdonInterpreter>();
 		sub->builtins = interp->builtins; // share host-registered builtins
+		sub->module_cache_dir = interp->module_cache_dir;
 
-		CodeLocation compile_res = sub->compile(source);
+		CodeLocation compile_res = sub->compile_cached(source);
 		if (compile_res.has_error)
 		{
 			err = compile_res;
@@ -1561,7 +1601,7 @@ void register_builtins(UdonInterpreter* interp)
 		UdonInterpreter* sub_ref = interp->get_imported_interpreter(sub_id);
 		if (sub_ref)
 		{
-			for (const auto& kv : sub_ref->globals)
+			for (const auto& kv : sub_ref->global_values())
 			{
 				array_set(out, kv.first, kv.second);
 			}
@@ -1735,7 +1775,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("split", "s:string, delim:string", "array", [](UdonInterpreter* interp, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("split", "s:string, delim:string", "array", [](UdonInterpreter* interp, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 2)
 		{
@@ -1750,7 +1790,7 @@ void register_builtins(UdonInterpreter* interp)
 		if (delim.empty())
 		{
 			for (size_t i = 0; i < s.size(); ++i)
-				array_set(out, std::to_string(i), make_string(std::string(1, s[i])));
+				array_set_at(out, static_cast<s64>(i), make_string(std::string(1, s[i])));
 			return true;
 		}
 		size_t idx = 0;
@@ -1759,7 +1799,7 @@ void register_builtins(UdonInterpreter* interp)
 		{
 			size_t next = s.find(delim, pos);
 			std::string chunk = (next == std::string::npos) ? s.substr(pos) : s.substr(pos, next - pos);
-			array_set(out, std::to_string(idx++), make_string(chunk));
+			array_set_at(out, idx++, make_string(chunk));
 			if (next == std::string::npos)
 				break;
 			pos = next + delim.size();
@@ -1767,7 +1807,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("glyphs", "s:string", "array", [](UdonInterpreter* interp, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("glyphs", "s:string", "array", [](UdonInterpreter* interp, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1)
 		{
@@ -1794,13 +1834,13 @@ void register_builtins(UdonInterpreter* interp)
 			if (i + len > s.size())
 				len = 1;
 			std::string glyph = s.substr(i, len);
-			array_set(out, std::to_string(idx++), make_string(glyph));
+			array_set_at(out, idx++, make_string(glyph));
 			i += len;
 		}
 		return true;
 	});
 
-	interp->register_function("join", "arr:array, delim:string", "string", [](UdonInterpreter* interp, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("join", "arr:array, delim:string", "string", [](UdonInterpreter* interp, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 2 || positional[0].type != UdonValue::Type::Array)
 		{
@@ -1839,7 +1879,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("concat", "parts:any...", "string", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation&)
+	interp->register_function("concat", "parts:any...", "string", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation&)
 	{
 		std::ostringstream ss;
 		for (const auto& v : positional)
@@ -1848,7 +1888,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("chr", "code:int", "string", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("chr", "code:int", "string", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1)
 		{
@@ -1881,7 +1921,7 @@ void register_builtins(UdonInterpreter* interp)
 
 	binary("pow", std::pow);
 	binary("atan2", std::atan2);
-	interp->register_function("mod_floor", "a:number, b:number", "number", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("mod_floor", "a:number, b:number", "number", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 2 || !is_numeric(positional[0]) || !is_numeric(positional[1]))
 		{
@@ -1908,7 +1948,7 @@ void register_builtins(UdonInterpreter* interp)
 	binary("max", [](double a, double b)
 	{ return a > b ? a : b; });
 
-	interp->register_function("digits", "n:number", "array", [](UdonInterpreter* interp, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("digits", "n:number", "array", [](UdonInterpreter* interp, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1 || !is_numeric(positional[0]))
 		{
@@ -1938,7 +1978,7 @@ void register_builtins(UdonInterpreter* interp)
 		out.type = UdonValue::Type::Array;
 		out.array_map = interp->allocate_array();
 		for (size_t i = 0; i < parts.size(); ++i)
-			array_set(out, std::to_string(i), make_int(parts[i]));
+			array_set_at(out, static_cast<s64>(i), make_int(parts[i]));
 		return true;
 	});
 
@@ -1963,7 +2003,7 @@ void register_builtins(UdonInterpreter* interp)
 	{ return a | b; });
 	binary_int("bit_xor", [](s64 a, s64 b)
 	{ return a ^ b; });
-	interp->register_function("bit_not", "x:int", "int", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("bit_not", "x:int", "int", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1 || !is_integer_type(positional[0]))
 		{
@@ -1988,7 +2028,7 @@ void register_builtins(UdonInterpreter* interp)
 			return true;
 		}
 		std::ostringstream ss;
-		ss << std::hex << std::setfill('0') << std::setw(8) << crc32(positional[0].string_value);
+		ss << std::hex << std::setfill('0') << std::setw(8) << crc32(positional[0].string_value());
 		out = make_string(ss.str());
 		return true;
 	});
@@ -2001,7 +2041,7 @@ void register_builtins(UdonInterpreter* interp)
 			err.opt_error_message = "md5 expects (string)";
 			return true;
 		}
-		out = make_string(md5(positional[0].string_value));
+		out = make_string(md5(positional[0].string_value()));
 		return true;
 	});
 
@@ -2013,7 +2053,7 @@ void register_builtins(UdonInterpreter* interp)
 			err.opt_error_message = "sha1 expects (string)";
 			return true;
 		}
-		out = make_string(sha1(positional[0].string_value));
+		out = make_string(sha1(positional[0].string_value()));
 		return true;
 	});
 
@@ -2025,7 +2065,7 @@ void register_builtins(UdonInterpreter* interp)
 			err.opt_error_message = "to_base expects (number, digits_string)";
 			return true;
 		}
-		std::string digits = positional[1].string_value;
+		std::string digits = positional[1].string_value();
 		const size_t base = digits.size();
 		if (base < 2)
 		{
@@ -2067,8 +2107,8 @@ void register_builtins(UdonInterpreter* interp)
 			err.opt_error_message = "from_base expects (string, digits_string)";
 			return true;
 		}
-		std::string s = positional[0].string_value;
-		std::string digits = positional[1].string_value;
+		std::string s = positional[0].string_value();
+		std::string digits = positional[1].string_value();
 		const size_t base = digits.size();
 		if (base < 2)
 		{
@@ -2104,7 +2144,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("length", "UdonValue:any", "int", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("length", "UdonValue:any", "int", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1)
 		{
@@ -2114,7 +2154,7 @@ void register_builtins(UdonInterpreter* interp)
 		}
 		const auto& v = positional[0];
 		if (v.type == UdonValue::Type::String)
-			out = make_int(static_cast<s64>(v.string_value.size()));
+			out = make_int(static_cast<s64>(v.string_value().size()));
 		else if (v.type == UdonValue::Type::Array && v.array_map)
 			out = make_int(static_cast<s64>(array_length(v)));
 		else
@@ -2132,9 +2172,10 @@ void register_builtins(UdonInterpreter* interp)
 			return true;
 		}
 
-		const std::string tmpl = positional[0].string_value;
+		const std::string& text = positional[0].string_value();
+		std::shared_ptr<HtmlTemplate> tmpl = html_compile_cached(interp, text);
 		auto* fn_obj = interp->allocate_function();
-		fn_obj->template_body = tmpl;
+		fn_obj->template_body = text;
 		fn_obj->native_handler = [tmpl](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& inner_err) -> bool
 		{
 			std::unordered_map<std::string, UdonValue> replacements;
@@ -2147,29 +2188,7 @@ void register_builtins(UdonInterpreter* interp)
 				});
 			}
 
-			std::string rendered;
-			size_t pos = 0;
-			while (pos < tmpl.size())
-			{
-				size_t brace = tmpl.find('{', pos);
-				if (brace == std::string::npos)
-				{
-					rendered.append(tmpl.substr(pos));
-					break;
-				}
-				rendered.append(tmpl.substr(pos, brace - pos));
-				size_t end = tmpl.find('}', brace + 1);
-				if (end == std::string::npos)
-				{
-					rendered.append(tmpl.substr(brace));
-					break;
-				}
-				std::string key = tmpl.substr(brace + 1, end - brace - 1);
-				auto it = replacements.find(key);
-				if (it != replacements.end())
-					rendered.append(value_to_string(it->second));
-				pos = end + 1;
-			}
+			std::string rendered = html_render(*tmpl, replacements);
 			out = make_string(rendered);
 			(void)inner_err;
 			return true;
@@ -2190,7 +2209,7 @@ void register_builtins(UdonInterpreter* interp)
 		}
 
 		std::string parse_err;
-		auto tmpl = jsx_compile(positional[0].string_value, parse_err);
+		auto tmpl = jsx_compile_cached(interp, positional[0].string_value(), parse_err);
 		if (!tmpl)
 		{
 			err.has_error = true;
@@ -2227,7 +2246,7 @@ void register_builtins(UdonInterpreter* interp)
 		data->options = options;
 
 		auto* fn_obj = interp->allocate_function();
-		fn_obj->template_body = positional[0].string_value;
+		fn_obj->template_body = positional[0].string_value();
 		fn_obj->user_data = data;
 		for (const auto& kv : components)
 			fn_obj->rooted_values.push_back(kv.second);
@@ -2261,7 +2280,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("substr", "s:string, start:int, count:int", "string", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("substr", "s:string, start:int, count:int", "string", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() < 2 || positional.size() > 3)
 		{
@@ -2318,7 +2337,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("replace", "s:string, old:string, new:string, count:int", "string", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("replace", "s:string, old:string, new:string, count:int", "string", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() < 3 || positional.size() > 4)
 		{
@@ -2352,7 +2371,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("starts_with", "s:string, prefix:string", "bool", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("starts_with", "s:string, prefix:string", "bool", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 2)
 		{
@@ -2367,7 +2386,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("ends_with", "s:string, suffix:string", "bool", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("ends_with", "s:string, suffix:string", "bool", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 2)
 		{
@@ -2382,7 +2401,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("find", "s:string, needle:string, start:int", "int", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("find", "s:string, needle:string, start:int", "int", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() < 2 || positional.size() > 3)
 		{
@@ -2407,7 +2426,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("ord", "s:string", "int", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("ord", "s:string", "int", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1)
 		{
@@ -2425,7 +2444,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("contains", "hay:any, needle:any", "bool", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("contains", "hay:any, needle:any", "bool", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 2)
 		{
@@ -2457,7 +2476,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("to_upper", "s:string", "string", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("to_upper", "s:string", "string", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1)
 		{
@@ -2472,7 +2491,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("to_lower", "s:string", "string", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("to_lower", "s:string", "string", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1)
 		{
@@ -2487,7 +2506,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("trim", "s:string", "string", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("trim", "s:string", "string", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1)
 		{
@@ -2500,7 +2519,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	auto to_int_fn = [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	auto to_int_fn = [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1)
 		{
@@ -2514,7 +2533,7 @@ void register_builtins(UdonInterpreter* interp)
 		{
 			double d;
 			bool is_int;
-			if (parse_number_string(positional[0].string_value, d, is_int))
+			if (parse_number_string(positional[0].string_value(), d, is_int))
 				out = make_int(static_cast<s64>(d));
 			else
 				out = make_int(0);
@@ -2525,7 +2544,7 @@ void register_builtins(UdonInterpreter* interp)
 	};
 	interp->register_function("to_int", "value:any", "int", to_int_fn);
 
-	auto to_float_fn = [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	auto to_float_fn = [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1)
 		{
@@ -2539,7 +2558,7 @@ void register_builtins(UdonInterpreter* interp)
 		{
 			double d;
 			bool is_int;
-			if (parse_number_string(positional[0].string_value, d, is_int))
+			if (parse_number_string(positional[0].string_value(), d, is_int))
 				out = make_float(static_cast<f64>(d));
 			else
 				out = make_float(0.0);
@@ -2550,7 +2569,7 @@ void register_builtins(UdonInterpreter* interp)
 	};
 	interp->register_function("to_float", "value:any", "float", to_float_fn);
 
-	interp->register_function("to_string", "UdonValue:any", "string", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("to_string", "UdonValue:any", "string", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1)
 		{
@@ -2562,7 +2581,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("to_bool", "UdonValue:any", "bool", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("to_bool", "UdonValue:any", "bool", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1)
 		{
@@ -2573,7 +2592,7 @@ void register_builtins(UdonInterpreter* interp)
 		if (positional[0].type == UdonValue::Type::String)
 		{
 			bool b;
-			if (parse_bool_string(positional[0].string_value, b))
+			if (parse_bool_string(positional[0].string_value(), b))
 				out = make_bool(b);
 			else
 				out = make_bool(is_truthy(positional[0]));
@@ -2583,7 +2602,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("typeof", "UdonValue:any", "string", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("typeof", "UdonValue:any", "string", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1)
 		{
@@ -2595,7 +2614,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("range", "start:int, stop:int, step:int", "array", [](UdonInterpreter* interp, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("range", "start:int, stop:int, step:int", "array", [](UdonInterpreter* interp, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.empty() || positional.size() > 3)
 		{
@@ -2625,12 +2644,12 @@ void register_builtins(UdonInterpreter* interp)
 		if (step > 0)
 		{
 			for (s64 v = start; v < stop; v += step)
-				array_set(out, std::to_string(idx++), make_int(v));
+				array_set_at(out, idx++, make_int(v));
 		}
 		else
 		{
 			for (s64 v = start; v > stop; v += step)
-				array_set(out, std::to_string(idx++), make_int(v));
+				array_set_at(out, idx++, make_int(v));
 		}
 		return true;
 	});
@@ -2643,7 +2662,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("push", "arr:array, UdonValue:any", "none", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("push", "arr:array, UdonValue:any", "none", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 2 || positional[0].type != UdonValue::Type::Array)
 		{
@@ -2652,12 +2671,12 @@ void register_builtins(UdonInterpreter* interp)
 			return true;
 		}
 		int idx = static_cast<int>(array_length(positional[0]));
-		array_set(const_cast<UdonValue&>(positional[0]), std::to_string(idx), positional[1]);
+		array_set_at(const_cast<UdonValue&>(positional[0]), idx, positional[1]);
 		out = make_none();
 		return true;
 	});
 
-	interp->register_function("pop", "arr:array, key:any", "any", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("pop", "arr:array, key:any", "any", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.empty() || positional[0].type != UdonValue::Type::Array)
 		{
@@ -2669,6 +2688,19 @@ void register_builtins(UdonInterpreter* interp)
 		std::string key;
 		if (positional.size() >= 2)
 			key = key_from_value(positional[1]);
+		else if (arr.array_map && arr.array_map->dense)
+		{
+			auto& list = arr.array_map->list;
+			if (list.empty())
+			{
+				out = make_none();
+				return true;
+			}
+			out = std::move(list.back());
+			list.pop_back();
+			arr.array_map->size--;
+			return true;
+		}
 		else
 		{
 			s64 max_idx = -1;
@@ -2698,7 +2730,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("delete", "arr:array, key:any", "any", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("delete", "arr:array, key:any", "any", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 2 || positional[0].type != UdonValue::Type::Array)
 		{
@@ -2707,13 +2739,15 @@ void register_builtins(UdonInterpreter* interp)
 			return true;
 		}
 		UdonValue arr = positional[0];
-		std::string key = key_from_value(positional[1]);
-		if (!array_delete(arr, key, &out))
+		const bool found = array_is_table(arr)
+			? array_delete(arr, positional[1], &out)
+			: array_delete(arr, key_from_value(positional[1]), &out);
+		if (!found)
 			out = make_none();
 		return true;
 	});
 
-	interp->register_function("shift", "arr:array", "any", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("shift", "arr:array", "any", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 1 || positional[0].type != UdonValue::Type::Array)
 		{
@@ -2722,6 +2756,18 @@ void register_builtins(UdonInterpreter* interp)
 			return true;
 		}
 		UdonValue arr = positional[0];
+		if (arr.array_map && arr.array_map->dense)
+		{
+			auto& list = arr.array_map->list;
+			if (list.empty())
+			{
+				out = make_none();
+				return true;
+			}
+			out = list.pop_front();
+			arr.array_map->size--;
+			return true;
+		}
 		std::vector<s64> indices;
 		array_foreach(arr, [&](const UdonValue& k, const UdonValue&)
 		{
@@ -2772,7 +2818,7 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
-	interp->register_function("unshift", "arr:array, UdonValue:any", "none", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation& err)
+	interp->register_function("unshift", "arr:array, UdonValue:any", "none", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
 	{
 		if (positional.size() != 2 || positional[0].type != UdonValue::Type::Array)
 		{
@@ -2781,6 +2827,14 @@ void register_builtins(UdonInterpreter* interp)
 			return true;
 		}
 		UdonValue arr = positional[0];
+		if (arr.array_map && arr.array_map->dense)
+		{
+			gc_write_barrier(arr.array_map, positional[1]);
+			arr.array_map->list.push_front(positional[1]);
+			arr.array_map->size++;
+			out = make_none();
+			return true;
+		}
 		std::vector<s64> indices;
 		array_foreach(arr, [&](const UdonValue& k, const UdonValue&)
 		{
@@ -2825,6 +2879,147 @@ void register_builtins(UdonInterpreter* interp)
 		return true;
 	});
 
+	interp->register_function("set", "values:any...", "Set", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation&)
+	{
+		out = make_set();
+		for (const auto& v : positional)
+		{
+			if (v.type != UdonValue::Type::Array)
+			{
+				array_set(out, v, make_bool(true));
+				continue;
+			}
+			array_foreach(v, [&](const UdonValue&, const UdonValue& item)
+			{
+				array_set(out, item, make_bool(true));
+				return true;
+			});
+		}
+		return true;
+	});
+
+	interp->register_function("map", "source?:array", "Map", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
+	{
+		if (positional.size() > 1 || (positional.size() == 1 && positional[0].type != UdonValue::Type::Array))
+		{
+			err.has_error = true;
+			err.opt_error_message = "map expects ([array])";
+			return true;
+		}
+		out = make_map();
+		if (!positional.empty())
+		{
+			array_foreach(positional[0], [&](const UdonValue& k, const UdonValue& v)
+			{
+				array_set(out, k, v);
+				return true;
+			});
+		}
+		return true;
+	});
+
+	interp->register_function("add", "set:Set, value:any", "bool", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
+	{
+		if (positional.size() != 2 || !array_is_table(positional[0]) ||
+			positional[0].array_map->kind != UdonValue::ManagedArray::Kind::Set)
+		{
+			err.has_error = true;
+			err.opt_error_message = "add expects (Set, value)";
+			return true;
+		}
+		UdonValue s = positional[0];
+		const size_t before = s.array_map->size;
+		array_set(s, positional[1], make_bool(true));
+		out = make_bool(s.array_map->size != before);
+		return true;
+	});
+
+	interp->register_function("has", "c:array, key:any", "bool", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
+	{
+		if (positional.size() != 2 || positional[0].type != UdonValue::Type::Array)
+		{
+			err.has_error = true;
+			err.opt_error_message = "has expects (collection, key)";
+			return true;
+		}
+		UdonValue found;
+		out = make_bool(array_is_table(positional[0])
+				? array_get(positional[0], positional[1], found)
+				: array_get(positional[0], key_from_value(positional[1]), found));
+		return true;
+	});
+
+	interp->register_function("remove", "c:array, key:any", "bool", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
+	{
+		if (positional.size() != 2 || positional[0].type != UdonValue::Type::Array)
+		{
+			err.has_error = true;
+			err.opt_error_message = "remove expects (collection, key)";
+			return true;
+		}
+		UdonValue c = positional[0];
+		out = make_bool(array_is_table(c)
+				? array_delete(c, positional[1])
+				: array_delete(c, key_from_value(positional[1])));
+		return true;
+	});
+
+	interp->register_function("size", "c:array", "int", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
+	{
+		if (positional.size() != 1 || positional[0].type != UdonValue::Type::Array)
+		{
+			err.has_error = true;
+			err.opt_error_message = "size expects (collection)";
+			return true;
+		}
+		out = make_int(static_cast<s64>(array_length(positional[0])));
+		return true;
+	});
+
+	// For maps the keys decide membership and b's values win. Results list
+	// a's entries first, in a's order.
+	interp->register_function("union", "a:Set|Map, b:Set|Map", "Set|Map", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
+	{
+		if (!same_kind_tables(positional))
+		{
+			err.has_error = true;
+			err.opt_error_message = "union expects two Sets or two Maps";
+			return true;
+		}
+		const bool set = positional[0].array_map->kind == UdonValue::ManagedArray::Kind::Set;
+		out = set ? make_set() : make_map();
+		for (const auto& src : positional)
+		{
+			array_foreach(src, [&](const UdonValue& k, const UdonValue& v)
+			{
+				array_set(out, k, v);
+				return true;
+			});
+		}
+		return true;
+	});
+
+	interp->register_function("intersection", "a:Set|Map, b:Set|Map", "Set|Map", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation& err)
+	{
+		if (!same_kind_tables(positional))
+		{
+			err.has_error = true;
+			err.opt_error_message = "intersection expects two Sets or two Maps";
+			return true;
+		}
+		const bool set = positional[0].array_map->kind == UdonValue::ManagedArray::Kind::Set;
+		out = set ? make_set() : make_map();
+		const UdonValue& b = positional[1];
+		array_foreach(positional[0], [&](const UdonValue& k, const UdonValue&)
+		{
+			UdonValue found;
+			if (array_get(b, k, found))
+				array_set(out, k, found);
+			return true;
+		});
+		return true;
+	});
+
 	interp->register_function("time", "", "int", [](UdonInterpreter*, const std::vector<UdonValue>&, UdonValue& out, CodeLocation&)
 	{
 		using namespace std::chrono;
@@ -2854,7 +3049,8 @@ void register_builtins(UdonInterpreter* interp)
 			err.opt_error_message = "from_json expects (string)";
 			return true;
 		}
-		JsonParser parser(value_to_string(positional[0]));
+		const std::string text = value_to_string(positional[0]);
+		JsonParser parser(text);
 		if (!parser.parse_value(out))
 		{
 			err.has_error = true;
@@ -0,0 +1,642 @@
+#include "udonscript2.h"
+#include "helpers.h"
+#include "udonscript.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if __has_include("udon_build_id.h")
+#include "udon_build_id.h" // UDON_BUILD_ID, written by the build
+#endif
+
+// Compiled module files. Layout: a fixed ModuleHeader, then the interpreter
+// tables compile() fills (legacy bodies and their metadata, global
+// declarations, event handlers, context info), then every US2Function.
+// Integers are native-endian and instruction arrays are stored in their
+// in-memory layout, 8-byte aligned, so loading one is a bulk copy out of the
+// mapped file. The header pins everything that layout depends on.
+
+// Bump whenever the layout below changes. Changes to the code the parser, the
+// translator or the optimiser emit are caught by the build id: the build
+// (CMake or make) hashes every core source into udon_build_id.h. A build
+// without it falls back to when this file was compiled.
+constexpr u32 kUS2ModuleVersion = 3;
+
+static u64 build_id()
+{
+#ifdef UDON_BUILD_ID
+	return UDON_BUILD_ID;
+#else
+	return us2_source_hash(__DATE__ " " __TIME__);
+#endif
+}
+
+struct ModuleHeader
+{
+	char magic[8];
+	u32 version;
+	u32 instruction_size;
+	u32 opcode_count;
+	u32 legacy_opcode_count;
+	u64 source_hash;
+	u64 source_size;
+	u32 optimized;
+	u32 reserved;
+	u64 build_id;
+};
+
+static const char kModuleMagic[8] = { 'U', 'D', 'O', 'N', 'U', 'S', '2', 'M' };
+
+static ModuleHeader module_header(const std::string& source, bool optimized)
+{
+	ModuleHeader h;
+	std::memset(&h, 0, sizeof(h));
+	std::memcpy(h.magic, kModuleMagic, sizeof(h.magic));
+	h.version = kUS2ModuleVersion;
+	h.instruction_size = static_cast<u32>(sizeof(US2Instruction));
+	h.opcode_count = static_cast<u32>(kOpcode2Count);
+	h.legacy_opcode_count = static_cast<u32>(Opcode::OPCODE_MAX);
+	h.source_hash = us2_source_hash(source);
+	h.source_size = source.size();
+	h.optimized = optimized ? 1 : 0;
+	h.build_id = build_id();
+	return h;
+}
+
+u64 us2_source_hash(const std::string& source)
+{
+	u64 h = 14695981039346656037ull; // FNV-1a
+	for (unsigned char c : source)
+	{
+		h ^= c;
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+std::string us2_default_cache_dir()
+{
+	if (const char* dir = std::getenv("UDON_CACHE_DIR"))
+		return dir;
+	if (const char* xdg = std::getenv("XDG_CACHE_HOME"))
+	{
+		if (*xdg)
+			return std::string(xdg) + "/udonscript";
+	}
+	if (const char* home = std::getenv("HOME"))
+	{
+		if (*home)
+			return std::string(home) + "/.cache/udonscript";
+	}
+	return "";
+}
+
+size_t us2_module_header_size()
+{
+	return sizeof(ModuleHeader);
+}
+
+std::string us2_module_path(const std::string& cache_dir, const std::string& source, bool optimized)
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx%s.us2m",
+		static_cast<unsigned long long>(us2_source_hash(source)), optimized ? "" : "-O0");
+	return cache_dir + "/" + name;
+}
+
+struct ModuleWriter
+{
+	std::string out;
+
+	template <typename T>
+	void pod(const T& v)
+	{
+		out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+	}
+	void u32_(u32 v) { pod(v); }
+	void s32_(s32 v) { pod(v); }
+	void u64_(u64 v) { pod(v); }
+	void str(const std::string& s)
+	{
+		u32_(static_cast<u32>(s.size()));
+		out.append(s);
+	}
+	void strings(const std::vector<std::string>& v)
+	{
+		u32_(static_cast<u32>(v.size()));
+		for (const auto& s : v)
+			str(s);
+	}
+	void slots(const std::vector<s32>& v)
+	{
+		u32_(static_cast<u32>(v.size()));
+		block(v.data(), v.size() * sizeof(s32));
+	}
+	void align()
+	{
+		out.append((8 - out.size() % 8) % 8, '\0');
+	}
+	void block(const void* data, size_t bytes)
+	{
+		align();
+		if (bytes > 0)
+			out.append(static_cast<const char*>(data), bytes);
+	}
+	bool value(const UdonValue& v)
+	{
+		pod(static_cast<u8>(v.type));
+		switch (v.type)
+		{
+			case UdonValue::Type::String:
+				str(v.string_value());
+				return true;
+			case UdonValue::Type::Int:
+			case UdonValue::Type::Float:
+			case UdonValue::Type::Bool:
+			case UdonValue::Type::None:
+				pod(v.int_value);
+				return true;
+			default:
+				return false; // heap values never appear in compiled code
+		}
+	}
+};
+
+struct ModuleReader
+{
+	const char* base = nullptr;
+	const char* p = nullptr;
+	const char* end = nullptr;
+	bool ok = true;
+
+	bool take(void* dst, size_t bytes)
+	{
+		if (!ok || static_cast<size_t>(end - p) < bytes)
+			return ok = false;
+		if (bytes == 0)
+			return true; // dst may be the null data() of an empty vector
+		std::memcpy(dst, p, bytes);
+		p += bytes;
+		return true;
+	}
+	template <typename T>
+	T pod()
+	{
+		T v{};
+		take(&v, sizeof(T));
+		return v;
+	}
+	u32 u32_() { return pod<u32>(); }
+	s32 s32_() { return pod<s32>(); }
+	u64 u64_() { return pod<u64>(); }
+	// Element counts are checked against the bytes left before anything is
+	// allocated for them.
+	u32 count(size_t min_element_size)
+	{
+		const u32 n = u32_();
+		if (ok && static_cast<u64>(n) * min_element_size > static_cast<u64>(end - p))
+			ok = false;
+		return ok ? n : 0;
+	}
+	std::string str()
+	{
+		const u32 n = count(1);
+		std::string s(p, ok ? n : 0);
+		p += ok ? n : 0;
+		return s;
+	}
+	std::vector<std::string> strings()
+	{
+		std::vector<std::string> v(count(sizeof(u32)));
+		for (auto& s : v)
+			s = str();
+		return v;
+	}
+	std::vector<s32> slots()
+	{
+		std::vector<s32> v(count(sizeof(s32)));
+		block(v.data(), v.size() * sizeof(s32));
+		return v;
+	}
+	void align()
+	{
+		const size_t pad = (8 - static_cast<size_t>(p - base) % 8) % 8;
+		if (static_cast<size_t>(end - p) < pad)
+			ok = false;
+		else
+			p += pad;
+	}
+	void block(void* dst, size_t bytes)
+	{
+		align();
+		take(dst, bytes);
+	}
+	UdonValue value()
+	{
+		const u8 type = pod<u8>();
+		switch (static_cast<UdonValue::Type>(type))
+		{
+			case UdonValue::Type::String:
+				return make_string(str());
+			case UdonValue::Type::Int:
+			case UdonValue::Type::Float:
+			case UdonValue::Type::Bool:
+			case UdonValue::Type::None:
+			{
+				UdonValue v{};
+				v.type = static_cast<UdonValue::Type>(type);
+				v.int_value = pod<s64>();
+				return v;
+			}
+			default:
+				ok = false;
+				return make_none();
+		}
+	}
+};
+
+// Read-only view of a whole file: mapped where the platform supports it,
+// read into memory elsewhere.
+struct ModuleFile
+{
+	const char* data = nullptr;
+	size_t size = 0;
+	std::string buffer;
+#if defined(__unix__) || defined(__APPLE__)
+	void* mapping = nullptr;
+#endif
+
+	bool open(const std::string& path)
+	{
+#if defined(__unix__) || defined(__APPLE__)
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size <= 0)
+		{
+			::close(fd);
+			return false;
+		}
+		void* m = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (m == MAP_FAILED)
+			return false;
+		mapping = m;
+		data = static_cast<const char*>(m);
+		size = static_cast<size_t>(st.st_size);
+		return true;
+#else
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		std::ostringstream ss;
+		ss << file.rdbuf();
+		buffer = ss.str();
+		data = buffer.data();
+		size = buffer.size();
+		return size > 0;
+#endif
+	}
+
+	~ModuleFile()
+	{
+#if defined(__unix__) || defined(__APPLE__)
+		if (mapping)
+			munmap(mapping, size);
+#endif
+	}
+};
+
+static bool write_function(ModuleWriter& w, const US2Function& fn)
+{
+	w.str(fn.name);
+	w.strings(fn.params);
+	w.u32_(fn.variadic ? 1 : 0);
+	w.slots(fn.param_slots);
+	w.s32_(fn.variadic_slot);
+	w.u64_(fn.frame_size);
+	w.s32_(fn.result_slot);
+	w.u32_(fn.needs_env ? 1 : 0);
+	w.u64_(fn.local_slots);
+	w.u64_(fn.unoptimized_size);
+
+	const US2Tables empty_tables;
+	const US2Tables& tables = fn.tables ? *fn.tables : empty_tables;
+	w.u32_(static_cast<u32>(tables.constants.size()));
+	for (const auto& v : tables.constants)
+	{
+		if (!w.value(v))
+			return false;
+	}
+	w.u32_(static_cast<u32>(tables.call_sites.size()));
+	for (const auto& site : tables.call_sites)
+	{
+		w.str(site.callee_name);
+		w.s32_(site.argc);
+		w.u32_(site.tail ? 1 : 0);
+	}
+	w.u32_(static_cast<u32>(tables.positions.size()));
+	w.block(tables.positions.data(), tables.positions.size() * sizeof(US2SourcePos));
+
+	// Code that already ran (the global initialiser and whatever it called)
+	// may be quickened and decoded; only the generic form is written.
+	const US2Code empty_code;
+	const US2Code& code = fn.code ? *fn.code : empty_code;
+	std::vector<US2Instruction> clean(code.size());
+	std::memset(static_cast<void*>(clean.data()), 0, clean.size() * sizeof(US2Instruction));
+	for (size_t i = 0; i < code.size(); ++i)
+	{
+		US2Instruction& c = clean[i];
+		c.dst = code[i].dst;
+		c.a = code[i].a;
+		c.b = code[i].b;
+		c.jump_target = code[i].jump_target;
+		c.k = code[i].k;
+		c.opcode = us2_generic_form(code[i].opcode);
+		c.has_literal = code[i].has_literal;
+	}
+	w.u32_(static_cast<u32>(clean.size()));
+	w.block(clean.data(), clean.size() * sizeof(US2Instruction));
+	return true;
+}
+
+// Global slot numbers are only meaningful inside the interpreter that
+// translated the code, so globals are re-resolved by the name their constant
+// keeps.
+// Depth-0 refs name registers of the function's own frame; deeper refs are
+// resolved against their environment at run time.
+static bool register_in_frame(const US2ValueRef& ref, size_t frame_size)
+{
+	return ref.frame_depth != 0 || (ref.index >= 0 && static_cast<size_t>(ref.index) < frame_size);
+}
+
+static bool slot_in_frame(s32 slot, size_t frame_size)
+{
+	return slot >= 0 && static_cast<size_t>(slot) < frame_size;
+}
+
+static bool read_function(ModuleReader& r, UdonInterpreter& interp, US2Function& fn)
+{
+	fn.name = r.str();
+	fn.params = r.strings();
+	fn.variadic = r.u32_() != 0;
+	fn.param_slots = r.slots();
+	fn.variadic_slot = r.s32_();
+	fn.frame_size = static_cast<size_t>(r.u64_());
+	fn.result_slot = r.s32_();
+	fn.needs_env = r.u32_() != 0;
+	fn.local_slots = static_cast<size_t>(r.u64_());
+	fn.unoptimized_size = static_cast<size_t>(r.u64_());
+
+	fn.tables = std::make_shared<US2Tables>();
+	US2Tables& tables = *fn.tables;
+	tables.constants.resize(r.count(1 + sizeof(u32)));
+	for (auto& v : tables.constants)
+		v = interp.symbols.intern(r.value());
+	tables.call_sites.resize(r.count(3 * sizeof(u32)));
+	for (auto& site : tables.call_sites)
+	{
+		site.callee_name = r.str();
+		site.argc = r.s32_();
+		site.tail = r.u32_() != 0;
+	}
+	tables.positions.resize(r.count(sizeof(US2SourcePos)));
+	r.block(tables.positions.data(), tables.positions.size() * sizeof(US2SourcePos));
+
+	fn.code = std::make_shared<US2Code>(r.count(sizeof(US2Instruction)));
+	US2Code& code = *fn.code;
+	r.block(code.data(), code.size() * sizeof(US2Instruction));
+	if (!r.ok)
+		return false;
+	const size_t frame = fn.frame_size;
+	if (frame > static_cast<size_t>(kUS2MaxSlots) || !slot_in_frame(fn.result_slot, frame) ||
+		(fn.variadic_slot != -1 && !slot_in_frame(fn.variadic_slot, frame)))
+		return false;
+	for (s32 slot : fn.param_slots)
+	{
+		if (!slot_in_frame(slot, frame))
+			return false;
+	}
+	for (auto& in : code)
+	{
+		u8 literal = 0; // a stored bool other than 0 or 1 is not a valid bool to read
+		std::memcpy(&literal, &in.has_literal, 1);
+		if (static_cast<size_t>(in.opcode) >= kOpcode2Count || literal > 1)
+			return false;
+		// b is a property site on literal GET_PROP/STORE_PROP and a global
+		// slot on LOAD_GLOBAL/STORE_GLOBAL (re-resolved below). A call's
+		// argument window starts at a (b for dynamic callees) and may sit at
+		// the end of the frame when it is empty.
+		bool a_is_register = true;
+		bool b_is_register = !(in.has_literal && (in.opcode == Opcode2::GET_PROP || in.opcode == Opcode2::STORE_PROP)) &&
+			in.opcode != Opcode2::LOAD_GLOBAL && in.opcode != Opcode2::STORE_GLOBAL;
+		if (in.opcode == Opcode2::CALL && in.k < tables.call_sites.size())
+		{
+			const US2CallSite& site = tables.call_sites[in.k];
+			const bool dynamic = site.callee_name.empty();
+			const US2ValueRef& base = dynamic ? in.b : in.a;
+			(dynamic ? b_is_register : a_is_register) = false;
+			if (site.argc < 0 || (base.frame_depth == 0 &&
+				(base.index < 0 || static_cast<size_t>(base.index) + static_cast<size_t>(site.argc) > frame)))
+				return false;
+		}
+		if (!register_in_frame(in.dst, frame) || (a_is_register && !register_in_frame(in.a, frame)) ||
+			(b_is_register && !register_in_frame(in.b, frame)))
+			return false;
+		if (in.jump_target < -1 || in.jump_target > static_cast<s32>(code.size()))
+			return false;
+		if (in.opcode == Opcode2::CALL ? in.k >= tables.call_sites.size()
+									   : (in.has_literal && in.k >= tables.constants.size()))
+			return false;
+		if ((in.opcode == Opcode2::GET_PROP || in.opcode == Opcode2::STORE_PROP) && in.has_literal)
+		{
+			// Inline caches are not written; every site starts cold.
+			if (in.b.index < 0)
+				return false;
+			if (static_cast<size_t>(in.b.index) >= tables.prop_sites.size())
+				tables.prop_sites.resize(static_cast<size_t>(in.b.index) + 1);
+		}
+		if (in.opcode == Opcode2::LOAD_GLOBAL || in.opcode == Opcode2::STORE_GLOBAL)
+		{
+			if (!in.has_literal)
+				return false;
+			in.b = { 0, interp.intern_global_slot(tables.constants[in.k].string_value()) };
+		}
+	}
+	return true;
+}
+
+bool us2_write_module(const UdonInterpreter& interp, const std::string& path, const std::string& source)
+{
+	ModuleWriter w;
+	w.pod(module_header(source, interp.optimize_us2));
+
+	w.u32_(static_cast<u32>(interp.instructions.size()));
+	for (const auto& kv : interp.instructions)
+	{
+		const std::string& name = kv.first;
+		w.str(name);
+		const std::vector<UdonInstruction> empty;
+		const std::vector<UdonInstruction>& body = kv.second ? *kv.second : empty;
+		w.u32_(static_cast<u32>(body.size()));
+		for (const auto& in : body)
+		{
+			w.pod(static_cast<u8>(in.opcode_instruction));
+			w.u32_(in.line);
+			w.u32_(in.column);
+			w.u32_(static_cast<u32>(in.operands.size()));
+			for (const auto& v : in.operands)
+			{
+				if (!w.value(v))
+					return false;
+			}
+		}
+		auto params = interp.function_params.find(name);
+		w.strings(params != interp.function_params.end() && params->second ? *params->second : std::vector<std::string>{});
+		auto variadic = interp.function_variadic.find(name);
+		w.u32_(variadic != interp.function_variadic.end() ? 1 : 0);
+		if (variadic != interp.function_variadic.end())
+			w.str(variadic->second);
+		auto slots = interp.function_param_slots.find(name);
+		w.slots(slots != interp.function_param_slots.end() && slots->second ? *slots->second : std::vector<s32>{});
+		auto frame = interp.function_frame_sizes.find(name);
+		w.u64_(frame != interp.function_frame_sizes.end() ? frame->second : 0);
+		auto vslot = interp.function_variadic_slot.find(name);
+		w.s32_(vslot != interp.function_variadic_slot.end() ? vslot->second : -1);
+	}
+
+	w.strings(interp.declared_global_order);
+	w.u32_(static_cast<u32>(interp.event_handlers.size()));
+	for (const auto& kv : interp.event_handlers)
+	{
+		w.str(kv.first);
+		w.strings(kv.second);
+	}
+	w.u32_(static_cast<u32>(interp.context_info.size()));
+	for (const auto& kv : interp.context_info)
+	{
+		w.str(kv.first);
+		w.strings(kv.second);
+	}
+	w.s32_(interp.lambda_counter);
+	w.s32_(interp.global_init_counter);
+
+	w.u32_(static_cast<u32>(interp.functions_v2.size()));
+	for (const auto& kv : interp.functions_v2)
+	{
+		if (!write_function(w, kv.second))
+			return false;
+	}
+
+	// Written aside and renamed into place, so a concurrent reader never maps
+	// a partial file.
+	std::string tmp_path = path + ".tmp";
+#if defined(__unix__) || defined(__APPLE__)
+	for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1))
+		mkdir(path.substr(0, slash).c_str(), 0755); // existing directories just fail
+	tmp_path += std::to_string(static_cast<long>(getpid()));
+#endif
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+		file.write(w.out.data(), static_cast<std::streamsize>(w.out.size()));
+		if (!file)
+		{
+			file.close();
+			std::remove(tmp_path.c_str());
+			return false;
+		}
+	}
+	if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+	{
+		std::remove(tmp_path.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool us2_read_module(UdonInterpreter& interp, const std::string& path, const std::string& source)
+{
+	ModuleFile file;
+	if (!file.open(path) || file.size < sizeof(ModuleHeader))
+		return false;
+	const ModuleHeader expected = module_header(source, interp.optimize_us2);
+	if (std::memcmp(file.data, &expected, sizeof(ModuleHeader)) != 0)
+		return false;
+
+	ModuleReader r;
+	r.base = file.data;
+	r.p = file.data + sizeof(ModuleHeader);
+	r.end = file.data + file.size;
+
+	const u32 function_count = r.count(sizeof(u32));
+	for (u32 i = 0; i < function_count && r.ok; ++i)
+	{
+		const std::string name = r.str();
+		auto body = std::make_shared<std::vector<UdonInstruction>>(r.count(1 + 3 * sizeof(u32)));
+		for (auto& in : *body)
+		{
+			const u8 opcode = r.pod<u8>();
+			if (opcode >= static_cast<u8>(Opcode::OPCODE_MAX))
+				return false;
+			in.opcode_instruction = static_cast<Opcode>(opcode);
+			in.line = r.u32_();
+			in.column = r.u32_();
+			in.operands.resize(r.count(1 + sizeof(u32)));
+			for (auto& v : in.operands)
+				v = r.value();
+		}
+		interp.instructions[name] = std::move(body);
+		interp.function_params[name] = std::make_shared<std::vector<std::string>>(r.strings());
+		if (r.u32_() != 0)
+			interp.function_variadic[name] = r.str();
+		interp.function_param_slots[name] = std::make_shared<std::vector<s32>>(r.slots());
+		interp.function_frame_sizes[name] = static_cast<size_t>(r.u64_());
+		interp.function_variadic_slot[name] = r.s32_();
+	}
+
+	interp.declared_global_order = r.strings();
+	interp.declared_globals.clear();
+	interp.declared_globals.insert(interp.declared_global_order.begin(), interp.declared_global_order.end());
+	const u32 event_count = r.count(sizeof(u32));
+	for (u32 i = 0; i < event_count && r.ok; ++i)
+	{
+		std::string event = r.str();
+		interp.event_handlers[event] = r.strings();
+	}
+	const u32 context_count = r.count(sizeof(u32));
+	for (u32 i = 0; i < context_count && r.ok; ++i)
+	{
+		std::string key = r.str();
+		interp.context_info[key] = r.strings();
+	}
+	interp.lambda_counter = r.s32_();
+	interp.global_init_counter = r.s32_();
+	if (!r.ok)
+		return false;
+
+	interp.rebuild_global_slots();
+	const u32 translated = r.count(sizeof(u32));
+	for (u32 i = 0; i < translated; ++i)
+	{
+		US2Function fn{};
+		if (!read_function(r, interp, fn))
+			return false;
+		auto code_it = interp.instructions.find(fn.name);
+		if (code_it != interp.instructions.end())
+			fn.legacy_code = code_it->second.get();
+		std::string name = fn.name;
+		interp.functions_v2[name] = std::move(fn);
+	}
+	return r.ok && r.p == r.end;
+}
@@ -4,6 +4,7 @@
 #include <memory>
 #include <functional>
 #include <limits>
+#include <algorithm>
 
 UdonValue make_none()
 {
@@ -38,10 +39,71 @@ UdonValue make_string(const std::string& s)
 {
 	UdonValue val{};
 	val.type = UdonValue::Type::String;
-	val.string_value = s;
+	val.string_ref = new UdonValue::ManagedString{ s };
 	return val;
 }
 
+UdonValue make_string(std::string&& s)
+{
+	UdonValue val{};
+	val.type = UdonValue::Type::String;
+	val.string_ref = new UdonValue::ManagedString{ std::move(s) };
+	return val;
+}
+
+// Constants longer than this are rarely repeated, and past the count limit
+// the table stops growing (generated code with unbounded distinct names).
+constexpr size_t kSymbolMaxLength = 256;
+constexpr size_t kSymbolMaxCount = 1 << 20;
+
+static UdonValue symbol_value(UdonValue::ManagedString* str)
+{
+	UdonValue val{};
+	val.type = UdonValue::Type::String;
+	val.string_ref = str;
+	++str->refs;
+	return val;
+}
+
+UdonSymbolTable::~UdonSymbolTable()
+{
+	clear();
+}
+
+void UdonSymbolTable::clear()
+{
+	for (auto& kv : symbols)
+	{
+		UdonValue::ManagedString* str = kv.second;
+		str->interned_by = nullptr; // no longer canonical; a later symbol may share its text
+		if (--str->refs == 0)
+			delete str;
+	}
+	symbols.clear();
+}
+
+UdonValue UdonSymbolTable::intern(const std::string& text)
+{
+	auto it = symbols.find(std::string_view(text));
+	if (it != symbols.end())
+		return symbol_value(it->second);
+	if (text.size() > kSymbolMaxLength || symbols.size() >= kSymbolMaxCount)
+		return make_string(text);
+	auto* str = new UdonValue::ManagedString{ text }; // the table's reference
+	str->hash = std::hash<std::string>()(str->text);
+	str->hashed = true;
+	str->interned_by = this;
+	symbols.emplace(std::string_view(str->text), str);
+	return symbol_value(str);
+}
+
+UdonValue UdonSymbolTable::intern(const UdonValue& v)
+{
+	if (v.type != UdonValue::Type::String || (v.string_ref && v.string_ref->interned_by == this))
+		return v;
+	return intern(v.string_value());
+}
+
 UdonValue make_array()
 {
 	UdonValue v;
@@ -53,15 +115,27 @@ UdonValue make_array()
 	return v;
 }
 
-UdonValue::ManagedArray::~ManagedArray()
+static UdonValue make_table(UdonValue::ManagedArray::Kind kind)
 {
-	Entry* e = head;
-	while (e)
-	{
-		Entry* next = e->next;
-		delete e;
-		e = next;
-	}
+	UdonValue v = make_array();
+	v.array_map->kind = kind;
+	v.array_map->dense = false;
+	return v;
+}
+
+UdonValue make_set()
+{
+	return make_table(UdonValue::ManagedArray::Kind::Set);
+}
+
+UdonValue make_map()
+{
+	return make_table(UdonValue::ManagedArray::Kind::Map);
+}
+
+bool array_is_table(const UdonValue& v)
+{
+	return v.type == UdonValue::Type::Array && v.array_map && v.array_map->kind != UdonValue::ManagedArray::Kind::Array;
 }
 
 void ensure_array(UdonValue& v)
@@ -85,7 +159,7 @@ std::string key_from_value(const UdonValue& v)
 			return ss.str();
 		}
 		case UdonValue::Type::String:
-			return v.string_value;
+			return v.string_value();
 		default:
 			return value_to_string(v);
 	}
@@ -106,11 +180,13 @@ std::string value_to_string(const UdonValue& v)
 			ss << (v.int_value ? "true" : "false");
 			break;
 		case UdonValue::Type::String:
-			ss << v.string_value;
+			ss << v.string_value();
 			break;
 		case UdonValue::Type::Array:
 		{
-			ss << "[";
+			const bool table = array_is_table(v);
+			const bool set = table && v.array_map->kind == UdonValue::ManagedArray::Kind::Set;
+			ss << (table ? "{" : "[");
 			if (v.array_map)
 			{
 				size_t count = 0;
@@ -118,12 +194,15 @@ std::string value_to_string(const UdonValue& v)
 				{
 					if (count > 0)
 						ss << ", ";
-					ss << value_to_string(k) << ": " << value_to_string(val);
+					if (set)
+						ss << value_to_string(val);
+					else
+						ss << value_to_string(k) << ": " << value_to_string(val);
 					count++;
 					return true;
 				});
 			}
-			ss << "]";
+			ss << (table ? "}" : "]");
 			break;
 		}
 		case UdonValue::Type::Function:
@@ -162,6 +241,10 @@ std::string value_type_name(const UdonValue& v)
 		case UdonValue::Type::String:
 			return "String";
 		case UdonValue::Type::Array:
+			if (v.array_map && v.array_map->kind == UdonValue::ManagedArray::Kind::Set)
+				return "Set";
+			if (v.array_map && v.array_map->kind == UdonValue::ManagedArray::Kind::Map)
+				return "Map";
 			return "Array";
 		case UdonValue::Type::Function:
 			return "Function";
@@ -183,7 +266,7 @@ double as_number(const UdonValue& v)
 	{
 		try
 		{
-			return std::stod(v.string_value);
+			return std::stod(v.string_value());
 		}
 		catch (...)
 		{
@@ -217,6 +300,86 @@ bool binary_numeric(const UdonValue& lhs, const UdonValue& rhs, double (*fn)(dou
 	return true;
 }
 
+bool array_dense_index(const UdonValue& key, size_t& out)
+{
+	if (key.type != UdonValue::Type::String)
+		return false;
+	const std::string& s = key.string_value();
+	if (s.empty() || s.size() > 18 || (s.size() > 1 && s[0] == '0'))
+		return false;
+	size_t n = 0;
+	for (char c : s)
+	{
+		if (c < '0' || c > '9')
+			return false;
+		n = n * 10 + static_cast<size_t>(c - '0');
+	}
+	out = n;
+	return true;
+}
+
+void UdonList::make_room_back()
+{
+	// Front room at least as large as the list came from shifts; sliding
+	// down costs no more than those did.
+	if (head > 0 && head >= count)
+	{
+		std::move(items.begin() + static_cast<std::ptrdiff_t>(head), items.begin() + static_cast<std::ptrdiff_t>(head + count), items.begin());
+		head = 0;
+		return;
+	}
+	items.resize(std::max<size_t>(8, items.size() * 2));
+}
+
+void UdonList::make_room_front()
+{
+	const size_t room = std::max<size_t>(4, count);
+	items.insert(items.begin(), room, UdonValue());
+	head = room;
+}
+
+static void array_make_sparse(UdonValue::ManagedArray* arr)
+{
+	if (!arr->dense)
+		return;
+	arr->dense = false;
+	arr->entries.reserve(arr->list.size());
+	UdonShape* shape = arr->owner ? arr->owner->root_shape() : nullptr;
+	for (size_t i = 0; i < arr->list.size(); ++i)
+	{
+		UdonValue::ManagedArray::Entry entry;
+		entry.key = make_string(std::to_string(i));
+		entry.value = std::move(arr->list[i]);
+		entry.seq = i;
+		if (shape)
+			shape = arr->owner->shape_transition(shape, entry.key.string_value());
+		arr->index.set(entry.key, arr->entries.size());
+		arr->entries.push_back(std::move(entry));
+	}
+	arr->shape = shape;
+	arr->next_seq = arr->list.size();
+	arr->list.release();
+}
+
+// Drops tombstones; only called when appending a new key, so positions in
+// entries are stable across deletes. foreach cursors hold seq numbers, which
+// compaction keeps, so a walk in progress carries on where it was.
+static void array_compact(UdonValue::ManagedArray* arr)
+{
+	auto& entries = arr->entries;
+	size_t w = 0;
+	for (size_t r = 0; r < entries.size(); ++r)
+	{
+		if (!entries[r].live)
+			continue;
+		if (w != r)
+			entries[w] = std::move(entries[r]);
+		arr->index.set(entries[w].key, w);
+		++w;
+	}
+	entries.resize(w);
+}
+
 bool array_get(const UdonValue& v, const UdonValue& key_in, UdonValue& out)
 {
 	if (v.type != UdonValue::Type::Array || !v.array_map)
@@ -224,10 +387,18 @@ bool array_get(const UdonValue& v, const UdonValue& key_in, UdonValue& out)
 	UdonValue key = key_in;
 	if (!is_hashable_value(key))
 		key = make_string(value_to_string(key_in));
-	auto* found = v.array_map->index.find(key);
-	if (!found || !(*found))
+	if (v.array_map->dense)
+	{
+		size_t i = 0;
+		if (!array_dense_index(key, i) || i >= v.array_map->list.size())
+			return false;
+		out = v.array_map->list[i];
+		return true;
+	}
+	const size_t* pos = v.array_map->index.find(key);
+	if (!pos)
 		return false;
-	out = (*found)->value;
+	out = v.array_map->entries[*pos].value;
 	return true;
 }
 
@@ -238,26 +409,48 @@ void array_set(UdonValue& v, const UdonValue& key_in, const UdonValue& value)
 	if (!is_hashable_value(key))
 		key = make_string(value_to_string(key_in));
 
-	const size_t h = hash_value(key);
-	if (auto* entry_ptr = v.array_map->index.find(key))
+	auto* arr = v.array_map;
+	gc_write_barrier(arr, value);
+	if (arr->dense)
+	{
+		size_t i = 0;
+		if (array_dense_index(key, i) && i <= arr->list.size())
+		{
+			if (i == arr->list.size())
+			{
+				arr->list.push_back(value);
+				arr->size++;
+			}
+			else
+				arr->list[i] = value;
+			return;
+		}
+		array_make_sparse(arr);
+	}
+
+	if (size_t* pos = arr->index.find(key))
 	{
-		if (*entry_ptr)
-			(*entry_ptr)->value = value;
+		if (arr->kind != UdonValue::ManagedArray::Kind::Set)
+			arr->entries[*pos].value = value;
 		return;
 	}
 
-	auto* entry = new UdonValue::ManagedArray::Entry();
-	entry->key = key;
-	entry->value = value;
-	entry->hash = h;
-	entry->prev = v.array_map->tail;
-	if (v.array_map->tail)
-		v.array_map->tail->next = entry;
-	v.array_map->tail = entry;
-	if (!v.array_map->head)
-		v.array_map->head = entry;
-	v.array_map->index.set(key, entry);
-	v.array_map->size++;
+	const size_t tombstones = arr->entries.size() - arr->size;
+	if (tombstones >= 8 && tombstones >= arr->size)
+		array_compact(arr);
+
+	// A shape implies no tombstones, so the new entry's position is the
+	// shape's key count.
+	if (arr->shape)
+		arr->shape = key.type == UdonValue::Type::String ? arr->owner->shape_transition(arr->shape, key.string_value()) : nullptr;
+
+	UdonValue::ManagedArray::Entry entry;
+	entry.key = key;
+	entry.value = arr->kind == UdonValue::ManagedArray::Kind::Set ? make_bool(true) : value;
+	entry.seq = arr->next_seq++;
+	arr->index.set(key, arr->entries.size());
+	arr->entries.push_back(std::move(entry));
+	arr->size++;
 }
 
 bool array_delete(UdonValue& v, const UdonValue& key_in, UdonValue* out)
@@ -267,24 +460,39 @@ bool array_delete(UdonValue& v, const UdonValue& key_in, UdonValue* out)
 	UdonValue key = key_in;
 	if (!is_hashable_value(key))
 		key = make_string(value_to_string(key_in));
-	auto* entry_ptr = v.array_map->index.find(key);
-	if (!entry_ptr || !(*entry_ptr))
+	auto* arr = v.array_map;
+	if (arr->dense)
+	{
+		auto& list = arr->list;
+		size_t i = 0;
+		if (!array_dense_index(key, i) || i >= list.size())
+			return false;
+		if (i + 1 == list.size())
+		{
+			if (out)
+				*out = list.back();
+			list.pop_back();
+			arr->size--;
+			return true;
+		}
+		array_make_sparse(arr);
+	}
+	const size_t* pos_ptr = arr->index.find(key);
+	if (!pos_ptr)
 		return false;
-	auto* entry = *entry_ptr;
+	const size_t pos = *pos_ptr;
+	arr->shape = nullptr; // positions no longer follow from the keys
+	auto& entry = arr->entries[pos];
 	if (out)
-		*out = entry->value;
-	if (entry->prev)
-		entry->prev->next = entry->next;
-	else
-		v.array_map->head = entry->next;
-	if (entry->next)
-		entry->next->prev = entry->prev;
-	else
-		v.array_map->tail = entry->prev;
-	v.array_map->index.erase(key);
-	if (v.array_map->size > 0)
-		v.array_map->size--;
-	delete entry;
+		*out = entry.value;
+	arr->index.erase(key);
+	entry.key = UdonValue();
+	entry.value = UdonValue();
+	entry.live = false;
+	while (!arr->entries.empty() && !arr->entries.back().live)
+		arr->entries.pop_back();
+	if (arr->size > 0)
+		arr->size--;
 	return true;
 }
 
@@ -293,18 +501,52 @@ void array_clear(UdonValue& v)
 	if (v.type != UdonValue::Type::Array || !v.array_map)
 		return;
 	auto* arr = v.array_map;
-	auto* e = arr->head;
-	while (e)
-	{
-		auto* next = e->next;
-		delete e;
-		e = next;
-	}
 	arr->index.clear();
-	arr->head = arr->tail = nullptr;
+	arr->entries.clear();
+	arr->list.clear();
+	arr->dense = arr->kind == UdonValue::ManagedArray::Kind::Array;
+	arr->shape = nullptr;
 	arr->size = 0;
 }
 
+bool array_get_at(const UdonValue& v, s64 index, UdonValue& out)
+{
+	if (v.type != UdonValue::Type::Array || !v.array_map)
+		return false;
+	if (v.array_map->dense)
+	{
+		if (index < 0 || static_cast<size_t>(index) >= v.array_map->list.size())
+			return false;
+		out = v.array_map->list[static_cast<size_t>(index)];
+		return true;
+	}
+	if (array_is_table(v))
+		return array_get(v, make_int(index), out);
+	return array_get(v, std::to_string(index), out);
+}
+
+void array_set_at(UdonValue& v, s64 index, const UdonValue& value)
+{
+	ensure_array(v);
+	auto* arr = v.array_map;
+	if (arr->dense && index >= 0 && static_cast<size_t>(index) <= arr->list.size())
+	{
+		gc_write_barrier(arr, value);
+		if (static_cast<size_t>(index) == arr->list.size())
+		{
+			arr->list.push_back(value);
+			arr->size++;
+		}
+		else
+			arr->list[static_cast<size_t>(index)] = value;
+		return;
+	}
+	if (array_is_table(v))
+		array_set(v, make_int(index), value);
+	else
+		array_set(v, std::to_string(index), value);
+}
+
 size_t array_length(const UdonValue& v)
 {
 	if (v.type != UdonValue::Type::Array || !v.array_map)
@@ -316,15 +558,125 @@ void array_foreach(const UdonValue& v, const std::function<bool(const UdonValue&
 {
 	if (v.type != UdonValue::Type::Array || !v.array_map)
 		return;
-	auto* entry = v.array_map->head;
-	while (entry)
+	s64 cursor = 0;
+	UdonValue key;
+	UdonValue value;
+	while ((cursor = iter_next(v, cursor)) != 0)
 	{
-		if (!fn(entry->key, entry->value))
+		iter_key(v, cursor, key);
+		iter_value(v, cursor, value);
+		if (!fn(key, value))
 			break;
-		entry = entry->next;
 	}
 }
 
+// Position of the first entry whose seq is at least seq. Seqs rise along
+// entries and never fall below their position, so without compaction the
+// entry sits at position seq and the search is skipped.
+static size_t entry_from_seq(const UdonValue::ManagedArray* arr, u64 seq)
+{
+	const auto& entries = arr->entries;
+	if (seq < entries.size() && entries[seq].seq == seq)
+		return static_cast<size_t>(seq);
+	auto it = std::lower_bound(entries.begin(), entries.end(), seq, [](const UdonValue::ManagedArray::Entry& e, u64 s)
+	{
+		return e.seq < s;
+	});
+	return static_cast<size_t>(it - entries.begin());
+}
+
+// The entry a cursor returned by iter_next points at, or null.
+static const UdonValue::ManagedArray::Entry* entry_at_cursor(const UdonValue::ManagedArray* arr, s64 cursor)
+{
+	const u64 seq = static_cast<u64>(cursor - 1);
+	const size_t pos = entry_from_seq(arr, seq);
+	if (pos >= arr->entries.size() || arr->entries[pos].seq != seq)
+		return nullptr;
+	return &arr->entries[pos];
+}
+
+s64 iter_next(const UdonValue& v, s64 cursor)
+{
+	if (cursor < 0)
+		return 0;
+	size_t pos = static_cast<size_t>(cursor);
+	if (v.type == UdonValue::Type::String)
+		return pos < v.string_value().size() ? static_cast<s64>(pos + 1) : 0;
+	if (v.type != UdonValue::Type::Array || !v.array_map)
+		return 0;
+	const auto* arr = v.array_map;
+	if (arr->dense)
+		return pos < arr->list.size() ? static_cast<s64>(pos + 1) : 0;
+	pos = entry_from_seq(arr, pos);
+	while (pos < arr->entries.size() && !arr->entries[pos].live)
+		++pos;
+	return pos < arr->entries.size() ? static_cast<s64>(arr->entries[pos].seq + 1) : 0;
+}
+
+// Keys "0", "1", ... handed out by foreach over a list or a string, shared so
+// the walk does not allocate per step. Positions past the cache get a fresh
+// string.
+static UdonValue index_key(size_t pos)
+{
+	constexpr size_t kIndexKeyCacheSize = 1 << 16;
+	thread_local std::vector<UdonValue> cache;
+	if (pos >= kIndexKeyCacheSize)
+		return make_string(std::to_string(pos));
+	if (pos >= cache.size())
+		cache.resize(std::min(kIndexKeyCacheSize, std::max(pos + 1, cache.size() * 2)));
+	UdonValue& s = cache[pos];
+	if (s.type != UdonValue::Type::String)
+		s = make_string(std::to_string(pos));
+	return s;
+}
+
+void iter_key(const UdonValue& v, s64 cursor, UdonValue& out)
+{
+	const size_t pos = static_cast<size_t>(cursor - 1);
+	if (v.type == UdonValue::Type::Array && v.array_map && !v.array_map->dense)
+	{
+		const auto* entry = cursor > 0 ? entry_at_cursor(v.array_map, cursor) : nullptr;
+		out = entry ? entry->key : make_none();
+		return;
+	}
+	out = index_key(pos);
+}
+
+// One-byte strings handed out by foreach over a string, shared so the walk
+// does not allocate per step.
+static const UdonValue& byte_string(unsigned char c)
+{
+	thread_local UdonValue cache[256];
+	UdonValue& s = cache[c];
+	if (s.type != UdonValue::Type::String)
+		s = make_string(std::string(1, static_cast<char>(c)));
+	return s;
+}
+
+void iter_value(const UdonValue& v, s64 cursor, UdonValue& out)
+{
+	const size_t pos = static_cast<size_t>(cursor - 1);
+	out = make_none();
+	if (cursor <= 0)
+		return;
+	if (v.type == UdonValue::Type::String)
+	{
+		if (pos < v.string_value().size())
+			out = byte_string(static_cast<unsigned char>(v.string_value()[pos]));
+		return;
+	}
+	if (v.type != UdonValue::Type::Array || !v.array_map)
+		return;
+	const auto* arr = v.array_map;
+	if (arr->dense)
+	{
+		if (pos < arr->list.size())
+			out = arr->list[pos];
+	}
+	else if (const auto* entry = entry_at_cursor(arr, cursor))
+		out = arr->kind == UdonValue::ManagedArray::Kind::Set ? entry->key : entry->value;
+}
+
 namespace
 {
 	bool try_integral_double(double d, s64& out)
@@ -364,7 +716,17 @@ size_t hash_value(const UdonValue& v)
 		case UdonValue::Type::Bool:
 			return std::hash<int>()(v.int_value ? 1 : 0);
 		case UdonValue::Type::String:
-			return std::hash<std::string>()(v.string_value);
+		{
+			const UdonValue::ManagedString* str = v.string_ref;
+			if (!str)
+				return std::hash<std::string>()(std::string());
+			if (!str->hashed)
+			{
+				str->hash = std::hash<std::string>()(str->text);
+				str->hashed = true;
+			}
+			return str->hash;
+		}
 		case UdonValue::Type::Float:
 		{
 			double d = v.float_value;
@@ -380,6 +742,16 @@ size_t hash_value(const UdonValue& v)
 	}
 }
 
+// Both operands are strings.
+static bool strings_equal(const UdonValue& a, const UdonValue& b)
+{
+	if (a.string_ref == b.string_ref)
+		return true;
+	if (a.string_ref && b.string_ref && a.string_ref->interned_by && a.string_ref->interned_by == b.string_ref->interned_by)
+		return false;
+	return a.string_value() == b.string_value();
+}
+
 bool hashable_values_equal(const UdonValue& a, const UdonValue& b)
 {
 	auto is_numberish = [](const UdonValue& v) -> bool
@@ -388,7 +760,7 @@ bool hashable_values_equal(const UdonValue& a, const UdonValue& b)
 	};
 
 	if (a.type == UdonValue::Type::String || b.type == UdonValue::Type::String)
-		return a.type == UdonValue::Type::String && b.type == UdonValue::Type::String && a.string_value == b.string_value;
+		return a.type == UdonValue::Type::String && b.type == UdonValue::Type::String && strings_equal(a, b);
 
 	if (is_numberish(a) && is_numberish(b))
 	{
@@ -421,7 +793,7 @@ bool equal_values(const UdonValue& a, const UdonValue& b, UdonValue& out)
 
 	if (a.type == UdonValue::Type::String && b.type == UdonValue::Type::String)
 	{
-		out = make_bool(a.string_value == b.string_value);
+		out = make_bool(strings_equal(a, b));
 		return true;
 	}
 
@@ -448,6 +820,29 @@ bool compare_values(const UdonValue& a, const UdonValue& b, Opcode op, UdonValue
 	if (a.type == UdonValue::Type::Array || b.type == UdonValue::Type::Array)
 		return false;
 
+	// Exact for int pairs, like equal_values and the arithmetic helpers; a trip
+	// through double would merge neighbouring ints above 2^53.
+	if (is_integer_type(a) && is_integer_type(b))
+	{
+		switch (op)
+		{
+			case Opcode::LT:
+				out = make_bool(a.int_value < b.int_value);
+				return true;
+			case Opcode::LTE:
+				out = make_bool(a.int_value <= b.int_value);
+				return true;
+			case Opcode::GT:
+				out = make_bool(a.int_value > b.int_value);
+				return true;
+			case Opcode::GTE:
+				out = make_bool(a.int_value >= b.int_value);
+				return true;
+			default:
+				return false;
+		}
+	}
+
 	double lhs = 0.0;
 	double rhs = 0.0;
 
@@ -500,7 +895,7 @@ bool is_truthy(const UdonValue& v)
 		case UdonValue::Type::Bool:
 			return v.int_value != 0;
 		case UdonValue::Type::String:
-			return !v.string_value.empty();
+			return !v.string_value().empty();
 		case UdonValue::Type::Array:
 			return v.array_map && v.array_map->size > 0;
 		case UdonValue::Type::Function:
@@ -9,7 +9,11 @@ UdonValue make_int(s64 v);
 UdonValue make_float(f64 v);
 UdonValue make_bool(bool v);
 UdonValue make_string(const std::string& s);
+UdonValue make_string(std::string&& s);
 UdonValue make_array();
+UdonValue make_set();
+UdonValue make_map();
+bool array_is_table(const UdonValue& v); // a Set or Map
 void ensure_array(UdonValue& v);
 std::string key_from_value(const UdonValue& v);
 std::string value_to_string(const UdonValue& v);
@@ -30,6 +34,9 @@ inline void array_set(UdonValue& v, const std::string& key, const UdonValue& val
 {
 	array_set(v, make_string(key), value);
 }
+bool array_get_at(const UdonValue& v, s64 index, UdonValue& out);
+void array_set_at(UdonValue& v, s64 index, const UdonValue& value);
+bool array_dense_index(const UdonValue& key, size_t& out);
 bool equal_values(const UdonValue& a, const UdonValue& b, UdonValue& out);
 bool compare_values(const UdonValue& a, const UdonValue& b, Opcode op, UdonValue& out);
 bool is_truthy(const UdonValue& v);
@@ -46,6 +53,14 @@ inline bool array_delete(UdonValue& v, const std::string& key, UdonValue* out =
 void array_clear(UdonValue& v);
 size_t array_length(const UdonValue& v);
 void array_foreach(const UdonValue& v, const std::function<bool(const UdonValue&, const UdonValue&)>& fn);
+// foreach protocol: cursor 0 starts a walk, iter_next returns the cursor for the
+// next element or 0 when done. Arrays walk in insertion order (list elements by
+// index), strings walk bytes with keys "0".."n-1"; other values are empty.
+// Neither list nor string walks allocate per step. Sets and maps walk in
+// insertion order too; a set's values are its elements.
+s64 iter_next(const UdonValue& v, s64 cursor);
+void iter_key(const UdonValue& v, s64 cursor, UdonValue& out);
+void iter_value(const UdonValue& v, s64 cursor, UdonValue& out);
 
 bool is_hashable_value(const UdonValue& v);
 size_t hash_value(const UdonValue& v);
@@ -7,6 +7,15 @@
 #include <charconv>
 #include <system_error>
 
+// An {expression} of a template, resolved once by jsx_compile: either a
+// literal or a property path into the props.
+struct JsxExpression
+{
+	bool is_literal = false;
+	UdonValue literal;
+	std::vector<std::string> path;
+};
+
 struct JsxAttribute
 {
 	enum class Kind
@@ -20,6 +29,7 @@ struct JsxAttribute
 	Kind kind = Kind::Static;
 	std::string name;
 	std::string value;
+	JsxExpression expr; // Expression and Spread
 };
 
 struct JsxNode
@@ -33,6 +43,7 @@ struct JsxNode
 
 	Type type = Type::Text;
 	std::string text; // for text and expression payloads
+	JsxExpression expr; // Expression
 	std::string tag; // empty tag denotes fragment
 	std::vector<JsxAttribute> attributes;
 	std::vector<JsxNode> children;
@@ -572,9 +583,8 @@ bool parse_literal_value(const std::string& expr, UdonValue& out)
 	return false;
 }
 
-bool resolve_prop_path(const PropMap& props, const std::string& expr, UdonValue& out)
+bool resolve_prop_path(const PropMap& props, const std::vector<std::string>& segments, UdonValue& out)
 {
-	const auto segments = split_path(expr);
 	if (segments.empty())
 		return false;
 
@@ -617,14 +627,35 @@ bool resolve_prop_path(const PropMap& props, const std::string& expr, UdonValue&
 	return false;
 }
 
-UdonValue resolve_expression(const std::string& expr, const PropMap& props)
+JsxExpression compile_expression(const std::string& expr)
 {
-	UdonValue literal;
-	if (parse_literal_value(expr, literal))
-		return literal;
+	JsxExpression out;
+	out.is_literal = parse_literal_value(expr, out.literal);
+	if (!out.is_literal)
+		out.path = split_path(expr);
+	return out;
+}
+
+void compile_expressions(JsxNode& node)
+{
+	if (node.type == JsxNode::Type::Expression)
+		node.expr = compile_expression(node.text);
+	for (auto& attr : node.attributes)
+	{
+		if (attr.kind == JsxAttribute::Kind::Expression || attr.kind == JsxAttribute::Kind::Spread)
+			attr.expr = compile_expression(attr.value);
+	}
+	for (auto& child : node.children)
+		compile_expressions(child);
+}
+
+UdonValue resolve_expression(const JsxExpression& expr, const PropMap& props)
+{
+	if (expr.is_literal)
+		return expr.literal;
 
 	UdonValue resolved;
-	if (resolve_prop_path(props, expr, resolved))
+	if (resolve_prop_path(props, expr.path, resolved))
 		return resolved;
 
 	return make_none();
@@ -738,11 +769,11 @@ std::vector<AttrEval> evaluate_attributes(const std::vector<JsxAttribute>& attrs
 				push_attr(attr.name, make_bool(true), true);
 				break;
 			case JsxAttribute::Kind::Expression:
-				push_attr(attr.name, resolve_expression(attr.value, props), false);
+				push_attr(attr.name, resolve_expression(attr.expr, props), false);
 				break;
 			case JsxAttribute::Kind::Spread:
 			{
-				UdonValue spread_val = resolve_expression(attr.value, props);
+				UdonValue spread_val = resolve_expression(attr.expr, props);
 				if (spread_val.type == UdonValue::Type::Array && spread_val.array_map)
 				{
 					auto ordered = ordered_entries(spread_val);
@@ -830,7 +861,7 @@ std::string render_node(const JsxNode& node,
 		case JsxNode::Type::Text:
 			return node.text;
 		case JsxNode::Type::Expression:
-			return render_value_for_text(resolve_expression(node.text, props));
+			return render_value_for_text(resolve_expression(node.expr, props));
 		case JsxNode::Type::Element:
 		{
 			if (node.tag.empty())
@@ -887,7 +918,7 @@ std::string render_node(const JsxNode& node,
 					if (call_err.has_error)
 						return "";
 					if (component_out.type == UdonValue::Type::String)
-						return component_out.string_value;
+						return component_out.string_value();
 					return value_to_string(component_out);
 				}
 			}
@@ -919,6 +950,7 @@ std::shared_ptr<JsxTemplate> jsx_compile(const std::string& source, std::string&
 	JsxParser parser(source);
 	if (!parser.parse(*tmpl, error))
 		return nullptr;
+	compile_expressions(tmpl->root);
 	return tmpl;
 }
 
@@ -933,3 +965,71 @@ std::string jsx_render(const JsxTemplate& tmpl,
 	err.has_error = false;
 	return render_node(tmpl.root, props, ctx);
 }
+
+std::shared_ptr<HtmlTemplate> html_compile(const std::string& source)
+{
+	auto tmpl = std::make_shared<HtmlTemplate>();
+	std::string text;
+	size_t pos = 0;
+	while (pos < source.size())
+	{
+		size_t brace = source.find('{', pos);
+		if (brace == std::string::npos)
+		{
+			text.append(source, pos, std::string::npos);
+			break;
+		}
+		size_t end = source.find('}', brace + 1);
+		if (end == std::string::npos)
+		{
+			text.append(source, pos, std::string::npos);
+			break;
+		}
+		text.append(source, pos, brace - pos);
+		tmpl->text.push_back(std::move(text));
+		text.clear();
+		tmpl->keys.push_back(source.substr(brace + 1, end - brace - 1));
+		pos = end + 1;
+	}
+	tmpl->text.push_back(std::move(text));
+	return tmpl;
+}
+
+std::string html_render(const HtmlTemplate& tmpl, const std::unordered_map<std::string, UdonValue>& replacements)
+{
+	std::string rendered = tmpl.text[0];
+	for (size_t i = 0; i < tmpl.keys.size(); ++i)
+	{
+		auto it = replacements.find(tmpl.keys[i]);
+		if (it != replacements.end())
+			rendered.append(value_to_string(it->second));
+		rendered.append(tmpl.text[i + 1]);
+	}
+	return rendered;
+}
+
+std::shared_ptr<JsxTemplate> jsx_compile_cached(UdonInterpreter* interp, const std::string& source, std::string& error)
+{
+	auto it = interp->jsx_templates.find(source);
+	if (it != interp->jsx_templates.end())
+		return it->second;
+	auto tmpl = jsx_compile(source, error);
+	if (!tmpl)
+		return nullptr;
+	if (interp->jsx_templates.size() >= UdonInterpreter::kTemplateCacheLimit)
+		interp->jsx_templates.clear(); // live closures keep their templates
+	interp->jsx_templates.emplace(source, tmpl);
+	return tmpl;
+}
+
+std::shared_ptr<HtmlTemplate> html_compile_cached(UdonInterpreter* interp, const std::string& source)
+{
+	auto it = interp->html_templates.find(source);
+	if (it != interp->html_templates.end())
+		return it->second;
+	auto tmpl = html_compile(source);
+	if (interp->html_templates.size() >= UdonInterpreter::kTemplateCacheLimit)
+		interp->html_templates.clear();
+	interp->html_templates.emplace(source, tmpl);
+	return tmpl;
+}
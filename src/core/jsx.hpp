@@ -4,9 +4,18 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 struct JsxTemplate;
 
+// A $html template split at its {key} placeholders: text[i] precedes keys[i],
+// and text has one entry more than keys.
+struct HtmlTemplate
+{
+	std::vector<std::string> text;
+	std::vector<std::string> keys;
+};
+
 std::shared_ptr<JsxTemplate> jsx_compile(const std::string& source, std::string& error);
 std::string jsx_render(const JsxTemplate& tmpl,
 	const std::unordered_map<std::string, UdonValue>& props,
@@ -14,3 +23,8 @@ std::string jsx_render(const JsxTemplate& tmpl,
 	const std::unordered_map<std::string, UdonValue>& options,
 	UdonInterpreter* interp,
 	CodeLocation& err);
+std::shared_ptr<HtmlTemplate> html_compile(const std::string& source);
+// Through the interpreter's template caches; parse errors are not cached.
+std::shared_ptr<JsxTemplate> jsx_compile_cached(UdonInterpreter* interp, const std::string& source, std::string& error);
+std::shared_ptr<HtmlTemplate> html_compile_cached(UdonInterpreter* interp, const std::string& source);
+std::string html_render(const HtmlTemplate& tmpl, const std::unordered_map<std::string, UdonValue>& replacements);
@@ -8,7 +8,7 @@
 #include <string>
 #include <vector>
 
-#define mfree free
+#define mfree std::free // not Arena::free inside members
 
 Arena::Arena(u64 size, std::string name)
 {
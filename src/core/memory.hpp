@@ -3,7 +3,10 @@
 #include "types.h"
 #include <string>
 #include <memory>
+#include <new>
 #include <typeinfo>
+#include <utility>
+#include <vector>
 
 struct Arena
 {
@@ -82,3 +85,99 @@ struct ArenaResetGuard
 		arena.reset();
 	}
 };
+
+#ifndef UDON_SLAB_POOL_PASSTHROUGH
+#if defined(__SANITIZE_ADDRESS__)
+#define UDON_SLAB_POOL_PASSTHROUGH 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define UDON_SLAB_POOL_PASSTHROUGH 1
+#endif
+#endif
+#endif
+#ifndef UDON_SLAB_POOL_PASSTHROUGH
+#define UDON_SLAB_POOL_PASSTHROUGH 0
+#endif
+
+// Fixed-size object pool: slots are carved out of slabs of SlabSize objects
+// and recycled LIFO through an intrusive free list. Slabs only go back to the
+// system in release(), which expects every object to be destroyed already.
+// Sanitizer builds pass through to new/delete so a use-after-free on a pooled
+// object is still caught instead of landing in a recycled slot.
+template <typename T, size_t SlabSize = 256>
+struct SlabPool
+{
+	union Slot
+	{
+		Slot* next;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	std::vector<Slot*> slabs;
+	Slot* free_slots = nullptr;
+	size_t live = 0;
+
+	SlabPool() = default;
+	SlabPool(const SlabPool&) = delete;
+	SlabPool& operator=(const SlabPool&) = delete;
+	~SlabPool()
+	{
+		release();
+	}
+
+	template <typename... Args>
+	T* create(Args&&... args)
+	{
+		++live;
+#if UDON_SLAB_POOL_PASSTHROUGH
+		return new T(std::forward<Args>(args)...);
+#else
+		if (!free_slots)
+			grow();
+		Slot* slot = free_slots;
+		free_slots = slot->next;
+		return new (slot->storage) T(std::forward<Args>(args)...);
+#endif
+	}
+
+	void destroy(T* obj)
+	{
+		if (!obj)
+			return;
+		--live;
+#if UDON_SLAB_POOL_PASSTHROUGH
+		delete obj;
+#else
+		obj->~T();
+		Slot* slot = reinterpret_cast<Slot*>(obj);
+		slot->next = free_slots;
+		free_slots = slot;
+#endif
+	}
+
+	void release()
+	{
+		for (Slot* slab : slabs)
+			::operator delete(slab);
+		slabs.clear();
+		free_slots = nullptr;
+		live = 0;
+	}
+
+	size_t capacity() const
+	{
+		return slabs.size() * SlabSize;
+	}
+
+private:
+	void grow()
+	{
+		Slot* slab = static_cast<Slot*>(::operator new(sizeof(Slot) * SlabSize));
+		slabs.push_back(slab);
+		for (size_t i = SlabSize; i-- > 0;)
+		{
+			slab[i].next = free_slots;
+			free_slots = &slab[i];
+		}
+	}
+};
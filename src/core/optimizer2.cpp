@@ -0,0 +1,614 @@
+#include "udonscript2.h"
+#include "helpers.h"
+#include "udonscript.h"
+
+#include <algorithm>
+
+// Passes over translated US2Code. Only depth-0 refs are registers of the
+// function being optimised; deeper refs belong to other frames and are left
+// alone. Slots below US2Function::local_slots are named locals, the rest are
+// translator temporaries.
+
+static bool is_register(const US2ValueRef& r)
+{
+	return r.frame_depth == 0 && r.index >= 0;
+}
+
+static bool is_binary(Opcode2 op)
+{
+	switch (op)
+	{
+		case Opcode2::ADD:
+		case Opcode2::SUB:
+		case Opcode2::CONCAT:
+		case Opcode2::MUL:
+		case Opcode2::DIV:
+		case Opcode2::MOD:
+		case Opcode2::EQ:
+		case Opcode2::NEQ:
+		case Opcode2::LT:
+		case Opcode2::LTE:
+		case Opcode2::GT:
+		case Opcode2::GTE:
+		case Opcode2::ADD_INT:
+		case Opcode2::ADD_FLOAT:
+		case Opcode2::SUB_INT:
+		case Opcode2::SUB_FLOAT:
+		case Opcode2::MUL_INT:
+		case Opcode2::MUL_FLOAT:
+		case Opcode2::EQ_INT:
+		case Opcode2::NEQ_INT:
+		case Opcode2::LT_INT:
+		case Opcode2::LT_FLOAT:
+		case Opcode2::LTE_INT:
+		case Opcode2::LTE_FLOAT:
+		case Opcode2::GT_INT:
+		case Opcode2::GT_FLOAT:
+		case Opcode2::GTE_INT:
+		case Opcode2::GTE_FLOAT:
+		case Opcode2::ITER_NEXT:
+		case Opcode2::ITER_KEY:
+		case Opcode2::ITER_VALUE:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static bool writes_dst(const US2Instruction& in)
+{
+	switch (in.opcode)
+	{
+		case Opcode2::MOVE:
+		case Opcode2::LOADK:
+		case Opcode2::LOAD_GLOBAL:
+		case Opcode2::NEGATE:
+		case Opcode2::TO_BOOL:
+		case Opcode2::LOGICAL_NOT:
+		case Opcode2::GET_PROP:
+		case Opcode2::MAKE_CLOSURE:
+		case Opcode2::CALL:
+			return true;
+		default:
+			return is_binary(in.opcode);
+	}
+}
+
+// Single-register reads that may be renamed by copy propagation.
+static bool reads_a(const US2Instruction& in)
+{
+	switch (in.opcode)
+	{
+		case Opcode2::MOVE:
+		case Opcode2::STORE_GLOBAL:
+		case Opcode2::NEGATE:
+		case Opcode2::TO_BOOL:
+		case Opcode2::LOGICAL_NOT:
+		case Opcode2::GET_PROP:
+		case Opcode2::STORE_PROP:
+		case Opcode2::JUMP_IF_FALSE:
+		case Opcode2::RETURN:
+			return true;
+		default:
+			return is_binary(in.opcode);
+	}
+}
+
+static bool reads_b(const US2Instruction& in)
+{
+	if (in.opcode == Opcode2::GET_PROP || in.opcode == Opcode2::STORE_PROP)
+		return !in.has_literal;
+	return is_binary(in.opcode);
+}
+
+// Calls read a contiguous argument window (and a dynamic callee in a).
+// Callees may also reach named locals through deeper refs, so a call reads
+// and may clobber every local.
+static void call_arguments(const US2Function& fn, const US2Instruction& in, s32& base, s32& count, bool& dynamic)
+{
+	const US2CallSite& site = fn.tables->call_sites[in.k];
+	dynamic = site.callee_name.empty();
+	base = dynamic ? in.b.index : in.a.index;
+	count = site.argc;
+}
+
+struct RegisterSet
+{
+	std::vector<u64> words;
+
+	explicit RegisterSet(size_t bits = 0) : words((bits + 63) / 64, 0) {}
+	bool test(s32 r) const
+	{
+		const size_t w = static_cast<size_t>(r) / 64;
+		return w < words.size() && (words[w] >> (static_cast<size_t>(r) % 64)) & 1u;
+	}
+	void set(s32 r)
+	{
+		const size_t w = static_cast<size_t>(r) / 64;
+		if (w < words.size())
+			words[w] |= u64(1) << (static_cast<size_t>(r) % 64);
+	}
+	void reset(s32 r)
+	{
+		const size_t w = static_cast<size_t>(r) / 64;
+		if (w < words.size())
+			words[w] &= ~(u64(1) << (static_cast<size_t>(r) % 64));
+	}
+	bool merge(const RegisterSet& other)
+	{
+		bool changed = false;
+		for (size_t i = 0; i < words.size(); ++i)
+		{
+			const u64 next = words[i] | other.words[i];
+			changed |= next != words[i];
+			words[i] = next;
+		}
+		return changed;
+	}
+};
+
+static bool is_block_end(const US2Instruction& in)
+{
+	return in.opcode == Opcode2::JUMP || in.opcode == Opcode2::JUMP_IF_FALSE ||
+		in.opcode == Opcode2::RETURN || in.opcode == Opcode2::HALT;
+}
+
+static std::vector<bool> find_leaders(const US2Code& code)
+{
+	std::vector<bool> leader(code.size() + 1, false);
+	leader[0] = true;
+	for (size_t i = 0; i < code.size(); ++i)
+	{
+		const auto& in = code[i];
+		if (in.jump_target >= 0 && static_cast<size_t>(in.jump_target) < code.size())
+			leader[static_cast<size_t>(in.jump_target)] = true;
+		if (is_block_end(in))
+			leader[i + 1] = true;
+	}
+	return leader;
+}
+
+static bool scalar_constant(const UdonValue& v)
+{
+	switch (v.type)
+	{
+		case UdonValue::Type::Int:
+		case UdonValue::Type::Float:
+		case UdonValue::Type::Bool:
+		case UdonValue::Type::String:
+		case UdonValue::Type::None:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static bool fold_binary(Opcode2 op, const UdonValue& lhs, const UdonValue& rhs, UdonValue& out)
+{
+	switch (op)
+	{
+		case Opcode2::ADD:
+			return add_values(lhs, rhs, out);
+		case Opcode2::SUB:
+			return sub_values(lhs, rhs, out);
+		case Opcode2::MUL:
+			return mul_values(lhs, rhs, out);
+		case Opcode2::DIV:
+			return div_values(lhs, rhs, out);
+		case Opcode2::MOD:
+			return mod_values(lhs, rhs, out);
+		case Opcode2::CONCAT:
+			out = make_string(value_to_string(lhs) + value_to_string(rhs));
+			return true;
+		case Opcode2::EQ:
+		case Opcode2::NEQ:
+			if (!equal_values(lhs, rhs, out))
+				return false;
+			if (op == Opcode2::NEQ)
+				out.int_value = out.int_value ? 0 : 1;
+			return true;
+		case Opcode2::LT:
+			return compare_values(lhs, rhs, Opcode::LT, out);
+		case Opcode2::LTE:
+			return compare_values(lhs, rhs, Opcode::LTE, out);
+		case Opcode2::GT:
+			return compare_values(lhs, rhs, Opcode::GT, out);
+		case Opcode2::GTE:
+			return compare_values(lhs, rhs, Opcode::GTE, out);
+		default:
+			return false;
+	}
+}
+
+static bool fold_unary(Opcode2 op, const UdonValue& src, UdonValue& out)
+{
+	switch (op)
+	{
+		case Opcode2::NEGATE:
+			if (src.type == UdonValue::Type::Int)
+				out = make_int(static_cast<s64>(0 - static_cast<u64>(src.int_value))); // INT64_MIN wraps to itself
+			else if (src.type == UdonValue::Type::Float)
+				out = make_float(-src.float_value);
+			else
+				return false;
+			return true;
+		case Opcode2::TO_BOOL:
+			out = make_bool(is_truthy(src));
+			return true;
+		case Opcode2::LOGICAL_NOT:
+			out = make_bool(!is_truthy(src));
+			return true;
+		default:
+			return false;
+	}
+}
+
+static void make_nop(US2Instruction& in)
+{
+	in = US2Instruction{};
+}
+
+// Forward pass within basic blocks: renames reads of registers that hold a
+// copy of another register, and folds operations on known constants.
+static bool propagate_and_fold(US2Function& fn, const std::vector<bool>& leader, s32 local_slots)
+{
+	US2Code& code = *fn.code;
+	const size_t frame_size = fn.frame_size;
+	bool changed = false;
+	std::vector<s32> copy_of(frame_size, -1);
+	std::vector<bool> known(frame_size, false);
+	std::vector<UdonValue> constant(frame_size);
+
+	auto forget_all = [&]()
+	{
+		std::fill(copy_of.begin(), copy_of.end(), -1);
+		std::fill(known.begin(), known.end(), false);
+	};
+	auto forget = [&](s32 r)
+	{
+		if (r < 0 || static_cast<size_t>(r) >= frame_size)
+			return;
+		copy_of[static_cast<size_t>(r)] = -1;
+		known[static_cast<size_t>(r)] = false;
+		for (auto& src : copy_of)
+		{
+			if (src == r)
+				src = -1;
+		}
+	};
+	auto rename = [&](US2ValueRef& ref)
+	{
+		if (!is_register(ref) || static_cast<size_t>(ref.index) >= frame_size)
+			return;
+		const s32 src = copy_of[static_cast<size_t>(ref.index)];
+		if (src >= 0)
+		{
+			ref.index = src;
+			changed = true;
+		}
+	};
+	auto constant_of = [&](const US2ValueRef& ref) -> const UdonValue*
+	{
+		if (!is_register(ref) || static_cast<size_t>(ref.index) >= frame_size || !known[static_cast<size_t>(ref.index)])
+			return nullptr;
+		return &constant[static_cast<size_t>(ref.index)];
+	};
+
+	for (size_t i = 0; i < code.size(); ++i)
+	{
+		if (leader[i])
+			forget_all();
+		auto& in = code[i];
+
+		if (reads_a(in))
+			rename(in.a);
+		if (reads_b(in))
+			rename(in.b);
+
+		UdonValue folded{};
+		bool fold = false;
+		if (is_binary(in.opcode) && in.opcode != Opcode2::ITER_NEXT &&
+			in.opcode != Opcode2::ITER_KEY && in.opcode != Opcode2::ITER_VALUE)
+		{
+			const UdonValue* lhs = constant_of(in.a);
+			const UdonValue* rhs = constant_of(in.b);
+			fold = lhs && rhs && fold_binary(in.opcode, *lhs, *rhs, folded);
+		}
+		else if (in.opcode == Opcode2::NEGATE || in.opcode == Opcode2::TO_BOOL || in.opcode == Opcode2::LOGICAL_NOT)
+		{
+			const UdonValue* src = constant_of(in.a);
+			fold = src && fold_unary(in.opcode, *src, folded);
+		}
+		else if (in.opcode == Opcode2::MOVE)
+		{
+			const UdonValue* src = constant_of(in.a);
+			if (src)
+			{
+				folded = *src;
+				fold = true;
+			}
+		}
+		else if (in.opcode == Opcode2::JUMP_IF_FALSE)
+		{
+			if (const UdonValue* cond = constant_of(in.a))
+			{
+				if (is_truthy(*cond))
+					make_nop(in);
+				else
+				{
+					in.opcode = Opcode2::JUMP;
+					in.a = {};
+				}
+				changed = true;
+				continue;
+			}
+		}
+		if (fold)
+		{
+			US2Instruction loadk{};
+			loadk.opcode = Opcode2::LOADK;
+			loadk.dst = in.dst;
+			loadk.has_literal = true;
+			loadk.k = us2_add_constant(fn, folded);
+			in = loadk;
+			changed = true;
+		}
+
+		if (in.opcode == Opcode2::STORE_PROP && is_register(in.dst))
+			forget(in.dst.index); // array_set may replace a non-array in place
+		if (in.opcode == Opcode2::CALL)
+		{
+			// the callee may write any named local through a deeper ref
+			for (s32 r = 0; r < local_slots; ++r)
+				forget(r);
+		}
+		if (!writes_dst(in) || !is_register(in.dst))
+			continue;
+		const s32 d = in.dst.index;
+		forget(d);
+		if (static_cast<size_t>(d) >= frame_size)
+			continue;
+		if (in.opcode == Opcode2::MOVE && is_register(in.a) && in.a.index != d &&
+			static_cast<size_t>(in.a.index) < frame_size)
+		{
+			const size_t src = static_cast<size_t>(in.a.index);
+			copy_of[static_cast<size_t>(d)] = in.a.index;
+			if (known[src])
+			{
+				known[static_cast<size_t>(d)] = true;
+				constant[static_cast<size_t>(d)] = constant[src];
+			}
+		}
+		else if (in.opcode == Opcode2::LOADK && scalar_constant(fn.tables->constants[in.k]))
+		{
+			known[static_cast<size_t>(d)] = true;
+			constant[static_cast<size_t>(d)] = fn.tables->constants[in.k];
+		}
+	}
+	return changed;
+}
+
+// Removes register writes nobody reads. Only instructions without side
+// effects go; arithmetic stays because it can fail at runtime. In frames with
+// an environment, named locals live in it where closures see them, so every
+// store to them is kept.
+static bool remove_dead_stores(US2Function& fn, s32 local_slots)
+{
+	US2Code& code = *fn.code;
+	const size_t frame_size = fn.frame_size;
+	const size_t n = code.size();
+	std::vector<RegisterSet> live_in(n, RegisterSet(frame_size));
+	std::vector<RegisterSet> live_out(n, RegisterSet(frame_size));
+
+	auto add_use = [&](RegisterSet& set, const US2ValueRef& r)
+	{
+		if (is_register(r))
+			set.set(r.index);
+	};
+	auto transfer = [&](size_t i, RegisterSet& in_set)
+	{
+		const auto& in = code[i];
+		in_set = live_out[i];
+		if (writes_dst(in) && is_register(in.dst))
+			in_set.reset(in.dst.index);
+		if (reads_a(in))
+			add_use(in_set, in.a);
+		if (reads_b(in))
+			add_use(in_set, in.b);
+		if (in.opcode == Opcode2::STORE_PROP)
+			add_use(in_set, in.dst);
+		if (in.opcode == Opcode2::CALL)
+		{
+			s32 base = 0;
+			s32 count = 0;
+			bool dynamic = false;
+			call_arguments(fn, in, base, count, dynamic);
+			for (s32 r = 0; r < count; ++r)
+				in_set.set(base + r);
+			if (dynamic)
+				add_use(in_set, in.a);
+			for (s32 r = 0; r < local_slots; ++r)
+				in_set.set(r);
+		}
+	};
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (size_t i = n; i-- > 0;)
+		{
+			const auto& in = code[i];
+			RegisterSet out(frame_size);
+			if (in.opcode != Opcode2::JUMP && in.opcode != Opcode2::RETURN && in.opcode != Opcode2::HALT && i + 1 < n)
+				out.merge(live_in[i + 1]);
+			if ((in.opcode == Opcode2::JUMP || in.opcode == Opcode2::JUMP_IF_FALSE) &&
+				in.jump_target >= 0 && static_cast<size_t>(in.jump_target) < n)
+				out.merge(live_in[static_cast<size_t>(in.jump_target)]);
+			live_out[i] = out;
+			RegisterSet next(frame_size);
+			transfer(i, next);
+			changed |= live_in[i].merge(next);
+		}
+	}
+
+	bool removed = false;
+	for (size_t i = 0; i < n; ++i)
+	{
+		auto& in = code[i];
+		if (in.opcode != Opcode2::MOVE && in.opcode != Opcode2::LOADK && in.opcode != Opcode2::LOAD_GLOBAL)
+			continue;
+		if (!is_register(in.dst))
+			continue;
+		const bool self_move = in.opcode == Opcode2::MOVE && in.a.frame_depth == 0 && in.a.index == in.dst.index;
+		const bool observable = fn.needs_env && in.dst.index < local_slots;
+		if (self_move || (!observable && !live_out[i].test(in.dst.index)))
+		{
+			make_nop(in);
+			removed = true;
+		}
+	}
+	return removed;
+}
+
+// Points jumps past chains of unconditional jumps, drops jumps to the next
+// instruction and blanks code no path reaches.
+static void simplify_control_flow(US2Code& code)
+{
+	const size_t n = code.size();
+	auto final_target = [&](s32 target) -> s32
+	{
+		for (int hops = 0; hops < 16; ++hops)
+		{
+			if (target < 0 || static_cast<size_t>(target) >= n)
+				break;
+			size_t t = static_cast<size_t>(target);
+			while (t < n && code[t].opcode == Opcode2::NOP)
+				++t;
+			if (t >= n || code[t].opcode != Opcode2::JUMP)
+				return static_cast<s32>(t < n ? t : static_cast<size_t>(target));
+			target = code[t].jump_target;
+		}
+		return target;
+	};
+	for (auto& in : code)
+	{
+		if (in.opcode == Opcode2::JUMP || in.opcode == Opcode2::JUMP_IF_FALSE)
+			in.jump_target = final_target(in.jump_target);
+	}
+
+	std::vector<bool> reached(n, false);
+	std::vector<size_t> work{ 0 };
+	while (!work.empty())
+	{
+		const size_t i = work.back();
+		work.pop_back();
+		if (i >= n || reached[i])
+			continue;
+		reached[i] = true;
+		const auto& in = code[i];
+		if ((in.opcode == Opcode2::JUMP || in.opcode == Opcode2::JUMP_IF_FALSE) && in.jump_target >= 0)
+			work.push_back(static_cast<size_t>(in.jump_target));
+		if (in.opcode != Opcode2::JUMP && in.opcode != Opcode2::RETURN && in.opcode != Opcode2::HALT)
+			work.push_back(i + 1);
+	}
+	for (size_t i = 0; i + 1 < n; ++i) // the trailing RETURN always stays
+	{
+		if (!reached[i])
+			make_nop(code[i]);
+	}
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		auto& in = code[i];
+		if (in.opcode != Opcode2::JUMP && in.opcode != Opcode2::JUMP_IF_FALSE)
+			continue;
+		size_t next = i + 1;
+		while (next < n && code[next].opcode == Opcode2::NOP)
+			++next;
+		if (in.jump_target >= 0 && static_cast<size_t>(in.jump_target) == next)
+			make_nop(in); // also drops a JUMP_IF_FALSE: conditions have no side effects
+	}
+}
+
+static void compact(US2Function& fn)
+{
+	US2Code& code = *fn.code;
+	const size_t n = code.size();
+	std::vector<s32> new_index(n + 1, 0);
+	s32 kept = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		new_index[i] = kept;
+		const bool last = i + 1 == n;
+		if (last || (code[i].opcode != Opcode2::NOP && code[i].opcode != Opcode2::POP))
+			++kept;
+	}
+	new_index[n] = kept;
+
+	US2Code out;
+	std::vector<US2SourcePos> positions;
+	out.reserve(static_cast<size_t>(kept));
+	positions.reserve(static_cast<size_t>(kept));
+	for (size_t i = 0; i < n; ++i)
+	{
+		const bool last = i + 1 == n;
+		if (!last && (code[i].opcode == Opcode2::NOP || code[i].opcode == Opcode2::POP))
+			continue;
+		out.push_back(code[i]);
+		positions.push_back(us2_position(fn, i));
+		auto& in = out.back();
+		if (in.jump_target >= 0 && static_cast<size_t>(in.jump_target) <= n)
+			in.jump_target = std::min(new_index[static_cast<size_t>(in.jump_target)], kept - 1);
+	}
+	code.swap(out);
+	fn.tables->positions.swap(positions);
+}
+
+// Folding leaves constants nothing refers to any more.
+static void prune_constants(US2Function& fn)
+{
+	std::vector<UdonValue> kept;
+	std::vector<u32> remap(fn.tables->constants.size(), 0);
+	std::vector<bool> used(fn.tables->constants.size(), false);
+	for (const auto& in : *fn.code)
+	{
+		if (in.has_literal && in.k < used.size())
+			used[in.k] = true;
+	}
+	for (size_t i = 0; i < fn.tables->constants.size(); ++i)
+	{
+		if (!used[i])
+			continue;
+		remap[i] = static_cast<u32>(kept.size());
+		kept.push_back(fn.tables->constants[i]);
+	}
+	for (auto& in : *fn.code)
+	{
+		if (in.has_literal && in.k < remap.size())
+			in.k = remap[in.k];
+	}
+	fn.tables->constants.swap(kept);
+}
+
+void optimize_us2(US2Function& fn)
+{
+	if (!fn.code || fn.code->empty() || !fn.tables)
+		return;
+	US2Code& code = *fn.code;
+	fn.unoptimized_size = code.size();
+	const s32 local_slots = static_cast<s32>(std::min(fn.local_slots, fn.frame_size));
+
+	for (int round = 0; round < 4; ++round)
+	{
+		const std::vector<bool> leader = find_leaders(code);
+		bool changed = propagate_and_fold(fn, leader, local_slots);
+		changed |= remove_dead_stores(fn, local_slots);
+		simplify_control_flow(code);
+		compact(fn);
+		if (!changed)
+			break;
+	}
+	prune_constants(fn);
+	us2_mark_tail_calls(fn); // compaction can bring a CALL next to its RETURN
+}
@@ -688,74 +688,52 @@ bool Parser::parse_statement(std::vector<UdonInstruction>& body, FunctionContext
 		if (!match_keyword("in"))
 			return !make_error(peek(), "Expected 'in' in foreach").has_error;
 		std::string collection_tmp = "__foreach_coll_" + std::to_string(body.size());
-		std::string keys_tmp = "__foreach_keys_" + std::to_string(body.size());
-		std::string idx_tmp = "__foreach_i_" + std::to_string(body.size());
+		std::string cursor_tmp = "__foreach_i_" + std::to_string(body.size());
 		declare_variable(ctx, collection_tmp);
-		declare_variable(ctx, keys_tmp);
-		declare_variable(ctx, idx_tmp);
+		declare_variable(ctx, cursor_tmp);
 		ResolvedVariable coll_var;
-		ResolvedVariable keys_var;
-		ResolvedVariable idx_var;
+		ResolvedVariable cursor_var;
 		resolve_variable(ctx, collection_tmp, coll_var);
-		resolve_variable(ctx, keys_tmp, keys_var);
-		resolve_variable(ctx, idx_tmp, idx_var);
+		resolve_variable(ctx, cursor_tmp, cursor_var);
 
 		if (!parse_expression(body, ctx))
 			return false;
 		emit_store_var(body, coll_var);
 
-		emit_load_var(body, coll_var);
-		std::vector<UdonValue> call_ops;
-		call_ops.push_back(make_string("keys"));
-		call_ops.push_back(make_int(1));
-		emit(body, Opcode::CALL, call_ops);
-		emit_store_var(body, keys_var);
-
 		emit(body, Opcode::PUSH_LITERAL, { make_int(0) });
-		emit_store_var(body, idx_var);
+		emit_store_var(body, cursor_var);
 
 		if (!expect_symbol(")", "Expected ')' after foreach header"))
 			return false;
 
-		size_t cond_index = body.size();
-		emit_load_var(body, idx_var);
-		emit_load_var(body, keys_var);
-		std::vector<UdonValue> len_ops;
-		len_ops.push_back(make_string("len"));
-		len_ops.push_back(make_int(1));
-		emit(body, Opcode::CALL, len_ops);
-		emit(body, Opcode::LT);
-		size_t jmp_false_index = body.size();
-		emit(body, Opcode::JUMP_IF_FALSE, { make_int(0) });
+		// The loop is rotated: one ITER_NEXT test on entry (failing into the
+		// else branch) and one at the bottom that jumps back to the body.
+		auto emit_advance = [&]() -> size_t
+		{
+			emit_load_var(body, coll_var);
+			emit_load_var(body, cursor_var);
+			emit(body, Opcode::ITER_NEXT);
+			emit_store_var(body, cursor_var);
+			emit_load_var(body, cursor_var);
+			size_t jump_index = body.size();
+			emit(body, Opcode::JUMP_IF_FALSE, { make_int(0) });
+			return jump_index;
+		};
 
-		emit_load_var(body, keys_var);
-		emit_load_var(body, idx_var);
-		std::vector<UdonValue> get_key_ops;
-		get_key_ops.push_back(make_string("array_get"));
-		get_key_ops.push_back(make_int(2));
-		emit(body, Opcode::CALL, get_key_ops);
-		emit_store_var(body, key_var);
+		size_t entry_jump = emit_advance();
+		size_t body_top = body.size();
 
 		if (has_value)
 		{
 			emit_load_var(body, coll_var);
-			emit_load_var(body, key_var);
-			std::vector<UdonValue> get_val_ops;
-			get_val_ops.push_back(make_string("array_get"));
-			get_val_ops.push_back(make_int(2));
-			emit(body, Opcode::CALL, get_val_ops);
-			emit_store_var(body, value_var);
-		}
-		else
-		{
-			emit_load_var(body, coll_var);
-			emit_load_var(body, key_var);
-			std::vector<UdonValue> get_val_ops;
-			get_val_ops.push_back(make_string("array_get"));
-			get_val_ops.push_back(make_int(2));
-			emit(body, Opcode::CALL, get_val_ops);
+			emit_load_var(body, cursor_var);
+			emit(body, Opcode::ITER_KEY);
 			emit_store_var(body, key_var);
 		}
+		emit_load_var(body, coll_var);
+		emit_load_var(body, cursor_var);
+		emit(body, Opcode::ITER_VALUE);
+		emit_store_var(body, has_value ? value_var : key_var);
 
 		loop_stack.push_back({});
 		loop_stack.back().allow_continue = true;
@@ -767,34 +745,19 @@ bool Parser::parse_statement(std::vector<UdonInstruction>& body, FunctionContext
 		for (size_t ci : loop_stack.back().continue_jumps)
 			body[ci].operands[0].int_value = static_cast<s64>(continue_target);
 
-		emit_load_var(body, idx_var);
-		emit(body, Opcode::PUSH_LITERAL, { make_int(1) });
-		emit(body, Opcode::ADD);
-		emit_store_var(body, idx_var);
-
-		emit(body, Opcode::JUMP, { make_int(static_cast<s64>(cond_index)) });
-		size_t else_check = body.size();
+		size_t exit_jump = emit_advance();
+		emit(body, Opcode::JUMP, { make_int(static_cast<s64>(body_top)) });
+		size_t else_start = body.size();
 
-		size_t final_exit = 0;
 		if (match_keyword("else"))
 		{
-			emit_load_var(body, idx_var);
-			emit(body, Opcode::PUSH_LITERAL, { make_int(0) });
-			emit(body, Opcode::EQ);
-			size_t skip_else = body.size();
-			emit(body, Opcode::JUMP_IF_FALSE, { make_int(0) });
-
 			if (!parse_statement_or_block(body, ctx, false))
 				return false;
-			final_exit = end_scope(ctx, body);
-			body[skip_else].operands[0].int_value = static_cast<s64>(final_exit);
-		}
-		else
-		{
-			final_exit = end_scope(ctx, body);
 		}
+		size_t final_exit = end_scope(ctx, body);
 
-		body[jmp_false_index].operands[0].int_value = static_cast<s64>(else_check);
+		body[entry_jump].operands[0].int_value = static_cast<s64>(else_start);
+		body[exit_jump].operands[0].int_value = static_cast<s64>(final_exit);
 		for (size_t bi : loop_stack.back().break_jumps)
 			body[bi].operands[0].int_value = static_cast<s64>(final_exit);
 		loop_stack.pop_back();
@@ -34,35 +34,7 @@ CodeLocation Parser2::parse()
 
 	interp.rebuild_global_slots();
 
-	auto populate_context_global = [&]()
-	{
-		UdonValue ctx{};
-		ctx.type = UdonValue::Type::Array;
-		ctx.array_map = interp.allocate_array();
-		for (const auto& pair : interp.context_info)
-		{
-			UdonValue arr{};
-			arr.type = UdonValue::Type::Array;
-			arr.array_map = interp.allocate_array();
-			s32 index = 0;
-			for (const auto& line : pair.second)
-			{
-				array_set(arr, std::to_string(index++), make_string(line));
-			}
-			array_set(ctx, pair.first, arr);
-		}
-		interp.globals["context"] = ctx;
-		auto slot = interp.get_global_slot("context");
-		if (slot >= 0)
-		{
-			if (interp.global_slots.size() <= static_cast<size_t>(slot))
-				interp.global_slots.resize(static_cast<size_t>(slot) + 1, make_none());
-			interp.global_slots[static_cast<size_t>(slot)] = ctx;
-		}
-	};
-	populate_context_global();
-
-	interp.functions_v2.clear();
+	interp.publish_context_global();
 
 	auto build_us2_for = [&](const std::string& name, const std::vector<UdonInstruction>& body, CodeLocation& out_err) -> bool
 	{
@@ -71,7 +43,7 @@ CodeLocation Parser2::parse()
 		auto fs_it = interp.function_frame_sizes.find(name);
 		if (fs_it != interp.function_frame_sizes.end())
 			frame_size = fs_it->second;
-		if (!compile_to_us2(name, body, frame_size, fn, out_err))
+		if (!compile_to_us2(interp, name, body, frame_size, fn, out_err))
 			return false;
 		auto param_it = interp.function_params.find(name);
 		if (param_it != interp.function_params.end() && param_it->second)
@@ -86,17 +58,34 @@ CodeLocation Parser2::parse()
 		if (vs_it != interp.function_variadic_slot.end())
 			fn.variadic_slot = vs_it->second;
 		fn.name = name;
+		auto code_it = interp.instructions.find(name);
+		if (code_it != interp.instructions.end())
+			fn.legacy_code = code_it->second.get();
+		fn.needs_env = us2_needs_environment(body, interp.instructions);
+		if (interp.optimize_us2)
+			optimize_us2(fn);
 		interp.functions_v2[name] = std::move(fn);
 		return true;
 	};
 
+	// Only bodies this chunk defined or redefined are translated. The parser
+	// gives every body it emits a fresh vector, so a translation whose
+	// legacy_code is still the current body is up to date.
+	bool translated = false;
 	for (const auto& kv : interp.instructions)
 	{
 		if (!kv.second)
 			continue;
+		auto v2_it = interp.functions_v2.find(kv.first);
+		if (v2_it != interp.functions_v2.end() && v2_it->second.legacy_code == kv.second.get())
+			continue;
+		interp.function_cache.erase(kv.first); // its wrapper still points at the old body
 		if (!build_us2_for(kv.first, *kv.second, res))
 			return res;
+		translated = true;
 	}
+	if (translated)
+		++interp.cache_version; // drops VM2 call sites linked to replaced functions
 
 	if (!module_global_init.empty())
 	{
@@ -11,6 +11,7 @@
 #include <functional>
 #include <utility>
 #include <chrono>
+#include <atomic>
 #if defined(__unix__) || defined(__APPLE__)
 #include <dlfcn.h>
 #endif
@@ -31,6 +32,7 @@ bool handle_builtin(UdonInterpreter* interp,
 	auto it = interp->builtins.find(name);
 	if (it == interp->builtins.end())
 		return false;
+	NativeCallScope native(interp);
 	return it->second.function(interp, positional, out, err);
 }
 
@@ -169,13 +171,16 @@ static bool get_index_value(const UdonValue& obj, const UdonValue& index, UdonVa
 {
 	if (obj.type == UdonValue::Type::Array)
 	{
-		if (!array_get(obj, key_from_value(index), out))
+		const bool found = (index.type == UdonValue::Type::Int)
+			? array_get_at(obj, index.int_value, out)
+			: array_is_table(obj) ? array_get(obj, index, out) : array_get(obj, key_from_value(index), out);
+		if (!found)
 			out = make_none();
 		return true;
 	}
 	if (obj.type == UdonValue::Type::String)
 	{
-		std::string s = obj.string_value;
+		std::string s = obj.string_value();
 		s64 idx = static_cast<s64>(as_number(index));
 		if (idx >= 0 && static_cast<size_t>(idx) < s.size())
 			out = make_string(std::string(1, s[static_cast<size_t>(idx)]));
@@ -185,7 +190,7 @@ static bool get_index_value(const UdonValue& obj, const UdonValue& index, UdonVa
 	}
 	if (index.type == UdonValue::Type::String)
 	{
-		return get_property_value(obj, index.string_value, out);
+		return get_property_value(obj, index.string_value(), out);
 	}
 
 	out = make_none();
@@ -274,6 +279,7 @@ static CodeLocation execute_function(UdonInterpreter* interp,
 		UdonEnvironment* env = env_at_depth(depth);
 		if (!env || slot < 0 || static_cast<size_t>(slot) >= env->slots.size())
 			return fail("Invalid variable store");
+		gc_write_barrier(env, v);
 		env->slots[static_cast<size_t>(slot)] = v;
 		return true;
 	};
@@ -308,7 +314,7 @@ static CodeLocation execute_function(UdonInterpreter* interp,
 	{
 		UdonValue vargs = make_array();
 		for (size_t i = positional_index; i < args.size(); ++i)
-			array_set(vargs, std::to_string(i - positional_index), args[i]);
+			array_set_at(vargs, static_cast<s64>(i - positional_index), args[i]);
 		if (variadic_slot_index >= 0)
 			store_slot(0, variadic_slot_index, vargs);
 	}
@@ -407,7 +413,7 @@ static CodeLocation execute_function(UdonInterpreter* interp,
 		{
 			steps_since_gc = 0;
 			last_gc_time = now;
-			interp->collect_garbage(current_env, &eval_stack.storage(), 10);
+			interp->collect_generational(current_env, &eval_stack.storage());
 		}
 	};
 
@@ -457,7 +463,7 @@ static CodeLocation execute_function(UdonInterpreter* interp,
 			case Opcode::LOAD_GLOBAL:
 			case Opcode::LOAD_VAR:
 			{
-				const std::string name = !instr.operands.empty() ? instr.operands[0].string_value : "";
+				const std::string name = !instr.operands.empty() ? instr.operands[0].string_value() : "";
 				s32 slot = instr.cached_global_slot;
 				if (slot == GLOBAL_SLOT_UNKNOWN || instr.cached_version != interp->cache_version)
 				{
@@ -477,7 +483,7 @@ static CodeLocation execute_function(UdonInterpreter* interp,
 				UdonValue v{};
 				if (!eval_stack.pop(v))
 					return ok;
-				const std::string name = !instr.operands.empty() ? instr.operands[0].string_value : "";
+				const std::string name = !instr.operands.empty() ? instr.operands[0].string_value() : "";
 				s32 slot = instr.cached_global_slot;
 				if (slot == GLOBAL_SLOT_UNKNOWN || instr.cached_version != interp->cache_version)
 				{
@@ -537,7 +543,7 @@ static CodeLocation execute_function(UdonInterpreter* interp,
 			}
 			case Opcode::GET_PROP:
 			{
-				const std::string name = !instr.operands.empty() ? instr.operands[0].string_value : "";
+				const std::string name = !instr.operands.empty() ? instr.operands[0].string_value() : "";
 				UdonValue prop;
 				bool success = false;
 				if (name == "[index]")
@@ -568,7 +574,7 @@ static CodeLocation execute_function(UdonInterpreter* interp,
 			}
 			case Opcode::STORE_PROP:
 			{
-				const std::string name = !instr.operands.empty() ? instr.operands[0].string_value : "";
+				const std::string name = !instr.operands.empty() ? instr.operands[0].string_value() : "";
 				UdonValue value;
 				if (!eval_stack.pop(value))
 					return ok;
@@ -588,8 +594,12 @@ static CodeLocation execute_function(UdonInterpreter* interp,
 						return ok;
 					}
 
-					std::string key = key_from_value(idx);
-					array_set(obj, key, value);
+					if (idx.type == UdonValue::Type::Int)
+						array_set_at(obj, idx.int_value, value);
+					else if (array_is_table(obj))
+						array_set(obj, idx, value);
+					else
+						array_set(obj, key_from_value(idx), value);
 				}
 				else
 				{
@@ -607,6 +617,26 @@ static CodeLocation execute_function(UdonInterpreter* interp,
 				}
 				break;
 			}
+			case Opcode::ITER_NEXT:
+			case Opcode::ITER_KEY:
+			case Opcode::ITER_VALUE:
+			{
+				UdonValue cursor;
+				UdonValue coll;
+				if (!eval_stack.pop(cursor))
+					return ok;
+				if (!eval_stack.pop(coll))
+					return ok;
+				UdonValue result;
+				if (instr.opcode_instruction == Opcode::ITER_NEXT)
+					result = make_int(iter_next(coll, cursor.int_value));
+				else if (instr.opcode_instruction == Opcode::ITER_KEY)
+					iter_key(coll, cursor.int_value, result);
+				else
+					iter_value(coll, cursor.int_value, result);
+				eval_stack.push(result);
+				break;
+			}
 			case Opcode::EQ:
 			case Opcode::NEQ:
 			case Opcode::LT:
@@ -695,7 +725,7 @@ static CodeLocation execute_function(UdonInterpreter* interp,
 					ok.opt_error_message = "Malformed MAKE_CLOSURE";
 					return ok;
 				}
-				const std::string fn_name = instr.operands[0].string_value;
+				const std::string fn_name = instr.operands[0].string_value();
 				auto* fn_obj = interp->allocate_function();
 				fn_obj->function_name = fn_name;
 				fn_obj->captured_env = current_env;
@@ -731,7 +761,7 @@ static CodeLocation execute_function(UdonInterpreter* interp,
 					ok.opt_error_message = "Malformed CALL instruction";
 					return ok;
 				}
-				const std::string callee = instr.operands[0].string_value;
+				const std::string callee = instr.operands[0].string_value();
 				const s32 arg_count = instr.operands[1].int_value;
 
 				ScratchVector<UdonValue> positional_buf(&interp->value_buffer_pool, static_cast<size_t>(std::max<s32>(arg_count, 0)));
@@ -778,6 +808,7 @@ static CodeLocation execute_function(UdonInterpreter* interp,
 
 				if (instr.cached_kind == UdonInstruction::CachedKind::Builtin)
 				{
+					NativeCallScope native(interp);
 					instr.cached_builtin(interp, positional, call_result, inner_err);
 					handled = !inner_err.has_error;
 				}
@@ -842,9 +873,9 @@ static CodeLocation execute_function(UdonInterpreter* interp,
 
 				if (!handled)
 				{
-					auto git = interp->globals.find(callee);
-					if (git != interp->globals.end())
-						handled = call_closure(interp, git->second, positional, call_result, inner_err);
+					UdonValue global_fn{};
+					if (interp->get_global_value(callee, global_fn))
+						handled = call_closure(interp, global_fn, positional, call_result, inner_err);
 				}
 
 				if (!handled)
@@ -920,6 +951,9 @@ UdonInterpreter::UdonInterpreter()
 		"LOGICAL_NOT",
 		"GET_PROP",
 		"STORE_PROP",
+		"ITER_NEXT",
+		"ITER_KEY",
+		"ITER_VALUE",
 		"MAKE_CLOSURE",
 		"CALL",
 		"RETURN",
@@ -949,14 +983,22 @@ void UdonInterpreter::reset_state(bool release_heaps, bool release_handles)
 	if (release_heaps)
 	{
 		for (auto* env : heap_environments)
-			delete env;
+			environment_pool.destroy(env);
 		for (auto* arr : heap_arrays)
-			delete arr;
+			array_pool.destroy(arr);
 		for (auto* fn : heap_functions)
-			delete fn;
+			function_pool.destroy(fn);
+		environment_pool.release();
+		array_pool.release();
+		function_pool.release();
 		heap_environments.clear();
 		heap_arrays.clear();
 		heap_functions.clear();
+		old_environments = 0;
+		old_arrays = 0;
+		old_functions = 0;
+		remembered_environments.clear();
+		remembered_arrays.clear();
 	}
 
 	instructions.clear();
@@ -967,20 +1009,28 @@ void UdonInterpreter::reset_state(bool release_heaps, bool release_handles)
 	function_variadic_slot.clear();
 	function_cache.clear();
 	event_handlers.clear();
-	globals.clear();
 	global_slots.clear();
+	global_slot_names.clear();
 	global_slot_lookup.clear();
 	functions_v2.clear();
+	symbols.clear();
+	if (vm2 && vm2->call_stack.empty())
+		vm2->reset();
 	declared_globals.clear();
 	declared_global_order.clear();
 	stack.clear();
 	active_env_roots.clear();
 	active_value_roots.clear();
+	active_vms.clear();
 	code_cache_versions.clear();
 	value_buffer_pool.clear();
 	gc_runs = 0;
 	gc_time_ms = 0;
-	cache_version = 1;
+	gc_debt_limit = gc_config.min_debt;
+	stats.gc_alloc_debt = 0;
+	gc_promoted_limit = gc_config.min_debt;
+	stats.gc_promoted = 0;
+	++cache_version; // never reuse a version: VM2 call sites compare against it
 	global_init_counter = 0;
 	lambda_counter = 0;
 	context_info.clear();
@@ -1087,6 +1137,29 @@ static bool resolve_function_by_name(UdonInterpreter* interp, const std::string&
 	return true;
 }
 
+// Makes an interpreter current for the duration of a VM2 entry.
+struct CurrentInterpreterGuard
+{
+	UdonInterpreter* prev;
+	CurrentInterpreterGuard(UdonInterpreter* s) : prev(g_udon_current)
+	{
+		g_udon_current = s;
+	}
+	~CurrentInterpreterGuard()
+	{
+		g_udon_current = prev;
+	}
+};
+
+// The persistent VM is bound on first use.
+static bool ensure_vm2(UdonInterpreter* interp, CodeLocation& err)
+{
+	if (interp->vm2)
+		return true;
+	interp->vm2 = std::make_unique<UdonInterpreter2>();
+	return interp->vm2->load_from_host(interp, err);
+}
+
 CodeLocation UdonInterpreter::invoke_function(const UdonValue& fn,
 	const std::vector<UdonValue>& positional,
 	UdonValue& out)
@@ -1107,6 +1180,7 @@ CodeLocation UdonInterpreter::invoke_function(const UdonValue& fn,
 
 	if (fn.function->native_handler)
 	{
+		NativeCallScope native(this);
 		fn.function->native_handler(this, positional, out, err);
 		return err;
 	}
@@ -1120,6 +1194,17 @@ CodeLocation UdonInterpreter::invoke_function(const UdonValue& fn,
 	}
 	UDON_ASSERT(binding.code && binding.params);
 
+	// Callbacks from builtins re-enter VM2 on top of whatever it is running;
+	// only bodies it has no translation of fall back to the stack interpreter.
+	const US2Function* body = vm2_callbacks ? us2_function_for(functions_v2, fn.function) : nullptr;
+	if (body)
+	{
+		CurrentInterpreterGuard guard(this);
+		if (!ensure_vm2(this, err))
+			return err;
+		return vm2->call(*body, binding.captured_env, positional, out);
+	}
+
 	static const std::vector<s32> empty_slots;
 	err = execute_function(this,
 		*binding.code,
@@ -1147,34 +1232,77 @@ UdonInterpreter::~UdonInterpreter()
 	}
 	dl_handles.clear();
 	for (auto* env : heap_environments)
-		delete env;
+		environment_pool.destroy(env);
 	for (auto* arr : heap_arrays)
-		delete arr;
+		array_pool.destroy(arr);
 	for (auto* fn : heap_functions)
-		delete fn;
+		function_pool.destroy(fn);
 }
 
 UdonValue::ManagedArray* UdonInterpreter::allocate_array()
 {
-	auto* arr = new UdonValue::ManagedArray();
+	auto* arr = array_pool.create();
+	arr->owner = this;
 	heap_arrays.push_back(arr);
+	++stats.gc_alloc_debt;
 	return arr;
 }
 
+// Records wider than this, or keys arriving once this many shapes exist,
+// leave the array in dictionary mode: objects used as maps would otherwise
+// grow the shape tree by one node per distinct key.
+constexpr u32 kShapeMaxKeys = 64;
+constexpr size_t kShapeMaxCount = 1 << 16;
+
+static u64 next_shape_id()
+{
+	static std::atomic<u64> next{ 0 };
+	return ++next;
+}
+
+UdonShape* UdonInterpreter::root_shape()
+{
+	if (shapes.empty())
+	{
+		shapes.emplace_back();
+		shapes.back().id = next_shape_id();
+	}
+	return &shapes.front();
+}
+
+UdonShape* UdonInterpreter::shape_transition(UdonShape* from, const std::string& key)
+{
+	auto it = from->transitions.find(key);
+	if (it != from->transitions.end())
+		return it->second;
+	if (from->count >= kShapeMaxKeys || shapes.size() >= kShapeMaxCount)
+		return nullptr;
+	shapes.emplace_back();
+	UdonShape* shape = &shapes.back();
+	shape->id = next_shape_id();
+	shape->parent = from;
+	shape->count = from->count + 1;
+	from->transitions.emplace(key, shape);
+	return shape;
+}
+
 UdonValue::ManagedFunction* UdonInterpreter::allocate_function()
 {
-	auto* fn = new UdonValue::ManagedFunction();
+	auto* fn = function_pool.create();
 	fn->magic = 0xF00DF00DCAFEBEEFULL;
 	heap_functions.push_back(fn);
+	++stats.gc_alloc_debt;
 	return fn;
 }
 
 UdonEnvironment* UdonInterpreter::allocate_environment(size_t slot_count, UdonEnvironment* parent)
 {
-	auto* env = new UdonEnvironment();
+	auto* env = environment_pool.create();
 	env->parent = parent;
+	env->owner = this;
 	env->slots.assign(slot_count, UdonValue());
 	heap_environments.push_back(env);
+	++stats.gc_alloc_debt;
 	return env;
 }
 
@@ -1229,6 +1357,24 @@ void UdonInterpreter::register_function(const std::string& name,
 	entry.return_type = return_type;
 	entry.function = fn;
 	builtins[name] = entry;
+	++cache_version; // VM2 call sites may have linked this name elsewhere
+}
+
+void UdonInterpreter::register_function(const std::string& name,
+	const std::string& arg_signature,
+	const std::string& return_type,
+	UdonSpanBuiltinFunction fn)
+{
+	UdonBuiltinEntry entry;
+	entry.arg_signature = arg_signature;
+	entry.return_type = return_type;
+	entry.function = [fn](UdonInterpreter* interp, const std::vector<UdonValue>& args, UdonValue& out, CodeLocation& err)
+	{
+		return fn(interp, UdonArgs(args), out, err);
+	};
+	entry.span_function = fn;
+	builtins[name] = entry;
+	++cache_version;
 }
 
 std::vector<Token> UdonInterpreter::tokenize(const std::string& source_code)
@@ -1250,19 +1396,59 @@ CodeLocation UdonInterpreter::compile(const std::string& source_code)
 	return compile_append(source_code);
 }
 
-void UdonInterpreter::rebuild_global_slots()
+CodeLocation UdonInterpreter::compile_cached(const std::string& source_code)
 {
-	if (global_slots.size() < declared_global_order.size())
-		global_slots.resize(declared_global_order.size(), make_none());
+	if (module_cache_dir.empty())
+		return compile(source_code);
+	const std::string path = us2_module_path(module_cache_dir, source_code, optimize_us2);
+	reset_state(false, false);
+	if (!us2_read_module(*this, path, source_code))
+	{
+		CodeLocation res = compile(source_code);
+		if (!res.has_error)
+			us2_write_module(*this, path, source_code);
+		return res;
+	}
+	publish_context_global();
+	++cache_version;
+	for (s32 i = 0; i < global_init_counter; ++i)
+	{
+		const std::string init_fn = "__globals_init_" + std::to_string(i);
+		if (instructions.find(init_fn) == instructions.end())
+			continue;
+		UdonValue dummy;
+		CodeLocation init_res = run(init_fn, {}, dummy);
+		if (init_res.has_error)
+			return init_res;
+	}
+	CodeLocation res{};
+	return res;
+}
 
-	global_slot_lookup.clear();
-	for (size_t i = 0; i < declared_global_order.size(); ++i)
+void UdonInterpreter::publish_context_global()
+{
+	UdonValue ctx{};
+	ctx.type = UdonValue::Type::Array;
+	ctx.array_map = allocate_array();
+	for (const auto& pair : context_info)
 	{
-		global_slot_lookup[declared_global_order[i]] = static_cast<s32>(i);
-		auto it = globals.find(declared_global_order[i]);
-		if (it != globals.end())
-			global_slots[i] = it->second;
+		UdonValue arr{};
+		arr.type = UdonValue::Type::Array;
+		arr.array_map = allocate_array();
+		s32 index = 0;
+		for (const auto& line : pair.second)
+		{
+			array_set_at(arr, index++, make_string(line));
+		}
+		array_set(ctx, pair.first, arr);
 	}
+	set_global_value("context", ctx);
+}
+
+void UdonInterpreter::rebuild_global_slots()
+{
+	for (const auto& name : declared_global_order)
+		intern_global_slot(name);
 }
 
 s32 UdonInterpreter::get_global_slot(const std::string& name) const
@@ -1273,33 +1459,55 @@ s32 UdonInterpreter::get_global_slot(const std::string& name) const
 	return it->second;
 }
 
-bool UdonInterpreter::get_global_value(const std::string& name, UdonValue& out, s32 slot_hint) const
+// Slots are append-only: once a name has a slot it keeps it until reset_state,
+// so compiled code can address globals by index.
+s32 UdonInterpreter::intern_global_slot(const std::string& name)
 {
-	s32 slot = (slot_hint >= 0) ? slot_hint : get_global_slot(name);
-	if (slot >= 0 && static_cast<size_t>(slot) < global_slots.size())
-	{
-		out = global_slots[static_cast<size_t>(slot)];
-		return true;
-	}
-	auto git = globals.find(name);
-	if (git != globals.end())
+	auto it = global_slot_lookup.find(name);
+	if (it != global_slot_lookup.end())
+		return it->second;
+	const s32 slot = static_cast<s32>(global_slot_names.size());
+	global_slot_names.push_back(name);
+	global_slot_lookup.emplace(name, slot);
+	if (global_slots.size() < global_slot_names.size())
+		global_slots.resize(global_slot_names.size(), make_none());
+	return slot;
+}
+
+std::vector<std::pair<std::string, UdonValue>> UdonInterpreter::global_values() const
+{
+	std::vector<std::pair<std::string, UdonValue>> out;
+	for (size_t i = 0; i < global_slot_names.size() && i < global_slots.size(); ++i)
 	{
-		out = git->second;
-		return true;
+		if (global_slots[i].type != UdonValue::Type::None)
+			out.emplace_back(global_slot_names[i], global_slots[i]);
 	}
-	return false;
+	return out;
 }
 
-void UdonInterpreter::set_global_value(const std::string& name, const UdonValue& v, s32 slot_hint)
+std::unordered_map<std::string, UdonValue> UdonInterpreter::globals() const
+{
+	std::unordered_map<std::string, UdonValue> out;
+	for (auto& kv : global_values())
+		out.emplace(std::move(kv.first), std::move(kv.second));
+	return out;
+}
+
+bool UdonInterpreter::get_global_value(const std::string& name, UdonValue& out, s32 slot_hint) const
 {
 	s32 slot = (slot_hint >= 0) ? slot_hint : get_global_slot(name);
-	if (slot >= 0)
-	{
-		if (global_slots.size() <= static_cast<size_t>(slot))
-			global_slots.resize(static_cast<size_t>(slot) + 1, make_none());
-		global_slots[static_cast<size_t>(slot)] = v;
-	}
-	globals[name] = v;
+	if (slot < 0 || static_cast<size_t>(slot) >= global_slots.size())
+		return false;
+	out = global_slots[static_cast<size_t>(slot)];
+	return true;
+}
+
+void UdonInterpreter::set_global_value(const std::string& name, const UdonValue& v, s32 slot_hint)
+{
+	s32 slot = (slot_hint >= 0) ? slot_hint : intern_global_slot(name);
+	if (global_slots.size() <= static_cast<size_t>(slot))
+		global_slots.resize(static_cast<size_t>(slot) + 1, make_none());
+	global_slots[static_cast<size_t>(slot)] = v;
 }
 
 CodeLocation UdonInterpreter::compile_append(const std::string& source_code)
@@ -1324,23 +1532,10 @@ CodeLocation UdonInterpreter::run_us2(std::string function_name,
 {
 	CodeLocation err{};
 	err.has_error = false;
-	struct Guard
-	{
-		UdonInterpreter* self;
-		UdonInterpreter* prev;
-		Guard(UdonInterpreter* s) : self(s), prev(g_udon_current)
-		{
-			g_udon_current = s;
-		}
-		~Guard()
-		{
-			g_udon_current = prev;
-		}
-	} guard(this);
-	UdonInterpreter2 vm;
-	if (!vm.load_from_host(this, err))
+	CurrentInterpreterGuard guard(this);
+	if (!ensure_vm2(this, err))
 		return err;
-	return vm.run(std::move(function_name), std::move(args), return_value);
+	return vm2->run(std::move(function_name), std::move(args), return_value);
 }
 
 void UdonInterpreter::clear()
@@ -1381,7 +1576,7 @@ std::string UdonInterpreter::dump_instructions() const
 			}
 			auto print_var = [&](const std::string& label)
 			{
-				ss << label << " " << (instr.operands.empty() ? "<anon>" : instr.operands[0].string_value);
+				ss << label << " " << (instr.operands.empty() ? "<anon>" : instr.operands[0].string_value());
 			};
 			switch (instr.opcode_instruction)
 			{
@@ -1466,17 +1661,26 @@ std::string UdonInterpreter::dump_instructions() const
 					ss << "NOT";
 					break;
 				case Opcode::GET_PROP:
-					ss << "GET_PROP " << (instr.operands.empty() ? "<name>" : instr.operands[0].string_value);
+					ss << "GET_PROP " << (instr.operands.empty() ? "<name>" : instr.operands[0].string_value());
 					break;
 				case Opcode::STORE_PROP:
-					ss << "STORE_PROP " << (instr.operands.empty() ? "<name>" : instr.operands[0].string_value);
+					ss << "STORE_PROP " << (instr.operands.empty() ? "<name>" : instr.operands[0].string_value());
+					break;
+				case Opcode::ITER_NEXT:
+					ss << "ITER_NEXT";
+					break;
+				case Opcode::ITER_KEY:
+					ss << "ITER_KEY";
+					break;
+				case Opcode::ITER_VALUE:
+					ss << "ITER_VALUE";
 					break;
 				case Opcode::MAKE_CLOSURE:
-					ss << "MAKE_CLOSURE " << (instr.operands.empty() ? "<name>" : instr.operands[0].string_value);
+					ss << "MAKE_CLOSURE " << (instr.operands.empty() ? "<name>" : instr.operands[0].string_value());
 					break;
 				case Opcode::CALL:
 				{
-					std::string target = instr.operands.size() > 0 ? instr.operands[0].string_value : "<anon>";
+					std::string target = instr.operands.size() > 0 ? instr.operands[0].string_value() : "<anon>";
 					s32 argc = instr.operands.size() > 1 ? instr.operands[1].int_value : 0;
 					ss << "CALL " << target << " argc=" << argc;
 					if (instr.operands.size() > 2)
@@ -1486,7 +1690,7 @@ std::string UdonInterpreter::dump_instructions() const
 						{
 							if (j > 2)
 								ss << ", ";
-							ss << instr.operands[j].string_value;
+							ss << instr.operands[j].string_value();
 						}
 						ss << "]";
 					}
@@ -1540,12 +1744,12 @@ static void mark_value(const UdonValue& v)
 		if (v.array_map->marked)
 			return;
 		v.array_map->marked = true;
-		auto* entry = v.array_map->head;
-		while (entry)
+		for (const auto& item : v.array_map->list)
+			mark_value(item);
+		for (const auto& entry : v.array_map->entries)
 		{
-			mark_value(entry->key);
-			mark_value(entry->value);
-			entry = entry->next;
+			mark_value(entry.key);
+			mark_value(entry.value);
 		}
 		return;
 	}
@@ -1561,6 +1765,16 @@ static void mark_value(const UdonValue& v)
 	}
 }
 
+static void record_gc_pause(UdonInterpreter& interp, std::chrono::steady_clock::time_point start)
+{
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	const u64 pause_us = static_cast<u64>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+	interp.gc_time_ms += pause_us / 1000;
+	interp.gc_runs += 1;
+	interp.stats.gc_last_pause_us = pause_us;
+	interp.stats.gc_max_pause_us = std::max(interp.stats.gc_max_pause_us, pause_us);
+}
+
 void UdonInterpreter::collect_garbage(UdonEnvironment* env_root,
 	const std::vector<UdonValue>* value_roots,
 	u32 time_budget_ms,
@@ -1597,8 +1811,18 @@ void UdonInterpreter::collect_garbage(UdonEnvironment* env_root,
 
 	for (auto* root_ptr : active_env_roots)
 		mark_env_root(root_ptr ? *root_ptr : nullptr);
-	for (auto& kv : globals)
-		mark_value(kv.second);
+	for (const auto* vm : active_vms)
+	{
+		for (const auto& frame : vm->call_stack)
+		{
+			mark_env_root(frame.env);
+			mark_env_root(frame.outer);
+			for (size_t i = 0; frame.regs && i < frame.size; ++i)
+				mark_value(frame.regs[i]);
+		}
+	}
+	for (auto& v : global_slots)
+		mark_value(v);
 	for (auto& v : stack)
 		mark_value(v);
 	if (!invalidate_caches)
@@ -1626,7 +1850,7 @@ void UdonInterpreter::collect_garbage(UdonEnvironment* env_root,
 		if (env->marked)
 			live_envs.push_back(env);
 		else
-			delete env;
+			environment_pool.destroy(env);
 		if (time_up())
 		{
 			for (size_t j = i + 1; j < heap_environments.size(); ++j)
@@ -1644,7 +1868,7 @@ void UdonInterpreter::collect_garbage(UdonEnvironment* env_root,
 		if (arr->marked)
 			survivors.push_back(arr);
 		else
-			delete arr;
+			array_pool.destroy(arr);
 		if (time_up())
 		{
 			for (size_t j = i + 1; j < heap_arrays.size(); ++j)
@@ -1662,7 +1886,7 @@ void UdonInterpreter::collect_garbage(UdonEnvironment* env_root,
 		if (fn->marked)
 			live_functions.push_back(fn);
 		else
-			delete fn;
+			function_pool.destroy(fn);
 		if (time_up())
 		{
 			for (size_t j = i + 1; j < heap_functions.size(); ++j)
@@ -1672,7 +1896,148 @@ void UdonInterpreter::collect_garbage(UdonEnvironment* env_root,
 	}
 	heap_functions.swap(live_functions);
 
-	const auto end = std::chrono::steady_clock::now();
-	gc_time_ms += static_cast<u64>(std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
-	gc_runs += 1;
+	// Everything left is old now. Survivors keep their mark, which is what
+	// stops the next minor collection from tracing into them.
+	for (auto* env : heap_environments)
+	{
+		env->old = true;
+		env->remembered = false;
+	}
+	for (auto* arr : heap_arrays)
+	{
+		arr->old = true;
+		arr->remembered = false;
+	}
+	for (auto* fn : heap_functions)
+		fn->old = true;
+	old_environments = heap_environments.size();
+	old_arrays = heap_arrays.size();
+	old_functions = heap_functions.size();
+	remembered_environments.clear();
+	remembered_arrays.clear();
+
+	const u64 live = heap_environments.size() + heap_arrays.size() + heap_functions.size();
+	stats.gc_alloc_debt = 0;
+	stats.gc_promoted = 0;
+	// In generational mode the nursery budget must not scale with the old
+	// generation, or minor pauses grow with the heap again.
+	gc_debt_limit = gc_config.generational ? gc_config.min_debt : std::max<u64>(gc_config.min_debt, live * gc_config.growth_percent / 100);
+	gc_promoted_limit = std::max<u64>(gc_config.min_debt, live * gc_config.major_growth_percent / 100);
+	record_gc_pause(*this, start);
+	++stats.gc_major_runs;
+}
+
+template <typename T>
+static size_t sweep_nursery(std::vector<T*>& heap, size_t old_count, SlabPool<T>& pool)
+{
+	size_t w = old_count;
+	for (size_t r = old_count; r < heap.size(); ++r)
+	{
+		T* obj = heap[r];
+		if (!obj->marked)
+		{
+			pool.destroy(obj);
+			continue;
+		}
+		obj->old = true;
+		heap[w++] = obj;
+	}
+	heap.resize(w);
+	return w - old_count;
+}
+
+// Minor collection: old objects are still marked from the collection that
+// promoted them, so marking stops at them and only the nursery and whatever
+// the remembered set points into get traced. Survivors are promoted.
+void UdonInterpreter::collect_nursery(UdonEnvironment* env_root,
+	const std::vector<UdonValue>* value_roots)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = old_environments; i < heap_environments.size(); ++i)
+		heap_environments[i]->marked = false;
+	for (size_t i = old_arrays; i < heap_arrays.size(); ++i)
+		heap_arrays[i]->marked = false;
+	for (size_t i = old_functions; i < heap_functions.size(); ++i)
+		heap_functions[i]->marked = false;
+
+	for (auto* env : remembered_environments)
+	{
+		for (auto& slot : env->slots)
+			mark_value(slot);
+		env->remembered = false;
+	}
+	for (auto* arr : remembered_arrays)
+	{
+		for (const auto& item : arr->list)
+			mark_value(item);
+		for (const auto& entry : arr->entries)
+			mark_value(entry.value);
+		arr->remembered = false;
+	}
+	remembered_environments.clear();
+	remembered_arrays.clear();
+
+	for (auto* root_ptr : active_env_roots)
+		mark_environment(root_ptr ? *root_ptr : nullptr);
+	for (const auto* vm : active_vms)
+	{
+		for (const auto& frame : vm->call_stack)
+		{
+			mark_environment(frame.env);
+			mark_environment(frame.outer);
+			for (size_t i = 0; frame.regs && i < frame.size; ++i)
+				mark_value(frame.regs[i]);
+		}
+	}
+	for (auto& v : global_slots)
+		mark_value(v);
+	for (auto& v : stack)
+		mark_value(v);
+	for (auto& kv : function_cache)
+		mark_value(kv.second);
+	for (auto* roots : active_value_roots)
+	{
+		for (const auto& v : *roots)
+			mark_value(v);
+	}
+	mark_environment(env_root);
+	if (value_roots)
+	{
+		for (const auto& v : *value_roots)
+			mark_value(v);
+	}
+
+	u64 promoted = sweep_nursery(heap_environments, old_environments, environment_pool);
+	promoted += sweep_nursery(heap_arrays, old_arrays, array_pool);
+	promoted += sweep_nursery(heap_functions, old_functions, function_pool);
+	old_environments = heap_environments.size();
+	old_arrays = heap_arrays.size();
+	old_functions = heap_functions.size();
+
+	stats.gc_promoted += promoted;
+	stats.gc_alloc_debt = 0;
+	gc_debt_limit = std::max<u64>(gc_config.min_debt, promoted * gc_config.growth_percent / 100);
+	record_gc_pause(*this, start);
+	++stats.gc_minor_runs;
+}
+
+void UdonInterpreter::collect_generational(UdonEnvironment* env_root,
+	const std::vector<UdonValue>* value_roots)
+{
+	if (!gc_config.generational || stats.gc_promoted >= gc_promoted_limit)
+		collect_garbage(env_root, value_roots, gc_config.time_budget_ms);
+	else
+		collect_nursery(env_root, value_roots);
+}
+
+void UdonInterpreter::collect_at_safepoint()
+{
+	if (native_call_depth > 0)
+	{
+		++stats.gc_deferred;
+		return;
+	}
+	++stats.gc_auto_runs;
+	collect_generational();
 }
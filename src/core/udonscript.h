@@ -2,7 +2,9 @@
 
 #include "types.h"
 #include <string>
+#include <string_view>
 #include <vector>
+#include <deque>
 #include <cassert>
 #include <unordered_map>
 #include <unordered_set>
@@ -23,6 +25,9 @@
 #endif
 
 struct US2Function;
+struct UdonInterpreter2;
+struct JsxTemplate;
+struct HtmlTemplate;
 
 struct CodeLocation
 {
@@ -62,7 +67,18 @@ struct UdonValue
 	struct ManagedArray;
 	struct ManagedFunction;
 
-	enum class Type
+	// Strings are immutable and shared by reference count, so copying a value
+	// never copies character data. Not traced by the GC.
+	struct ManagedString
+	{
+		std::string text;
+		u32 refs = 1;
+		mutable bool hashed = false;
+		mutable size_t hash = 0; // of text, filled in by the first hash_value()
+		const struct UdonSymbolTable* interned_by = nullptr; // set on the canonical copy of a symbol
+	};
+
+	enum class Type : u8
 	{
 		VariableReference,
 		Int,
@@ -74,35 +90,118 @@ struct UdonValue
 		None
 	};
 
+	// 16 bytes: the type tag and one payload word. Every payload except
+	// string_ref is copied bitwise.
 	Type type;
 	union
 	{
 		s64 int_value;
 		f64 float_value;
 		void* ptr_value; // for entity, material, mesh, texture references
+		ManagedString* string_ref;
+		ManagedArray* array_map;
+		ManagedFunction* function;
 	};
-	std::string string_value;
-	ManagedArray* array_map = nullptr;
-	ManagedFunction* function = nullptr;
 
-	UdonValue() : type(Type::None), ptr_value(nullptr), array_map(nullptr), function(nullptr) {}
+	UdonValue() : type(Type::None), int_value(0) {}
+	UdonValue(const UdonValue& other) : type(other.type), int_value(other.int_value)
+	{
+		retain();
+	}
+	UdonValue(UdonValue&& other) noexcept : type(other.type), int_value(other.int_value)
+	{
+		other.type = Type::None;
+		other.int_value = 0;
+	}
+	UdonValue& operator=(const UdonValue& other)
+	{
+		other.retain();
+		release();
+		type = other.type;
+		int_value = other.int_value;
+		return *this;
+	}
+	UdonValue& operator=(UdonValue&& other) noexcept
+	{
+		if (this != &other)
+		{
+			release();
+			type = other.type;
+			int_value = other.int_value;
+			other.type = Type::None;
+			other.int_value = 0;
+		}
+		return *this;
+	}
+	~UdonValue()
+	{
+		release();
+	}
+
+	const std::string& string_value() const
+	{
+		static const std::string empty;
+		return (type == Type::String && string_ref) ? string_ref->text : empty;
+	}
+
+private:
+	void retain() const
+	{
+		if (type == Type::String && string_ref)
+			++string_ref->refs;
+	}
+	void release()
+	{
+		if (type == Type::String && string_ref && --string_ref->refs == 0)
+			delete string_ref;
+	}
 };
 
+static_assert(sizeof(UdonValue) <= 16, "UdonValue should stay two words");
+
 bool is_hashable_value(const UdonValue& v);
 size_t hash_value(const UdonValue& v);
 bool hashable_values_equal(const UdonValue& a, const UdonValue& b);
 
+// Canonical copies of names and keys. Interning returns the one string that
+// holds a given text, hashed up front, so two keys interned by the same table
+// are equal exactly when they are the same pointer. The table keeps every
+// symbol alive until it is cleared, so only compiled code's constants (names,
+// literal keys) are interned, never keys that come from data.
+struct UdonSymbolTable
+{
+	UdonSymbolTable() = default;
+	UdonSymbolTable(const UdonSymbolTable&) = delete;
+	UdonSymbolTable& operator=(const UdonSymbolTable&) = delete;
+	~UdonSymbolTable();
+
+	UdonValue intern(const std::string& text);
+	UdonValue intern(const UdonValue& v); // non-strings are returned unchanged
+	void clear(); // strings still referenced elsewhere live on as plain strings
+	size_t size() const { return symbols.size(); }
+
+	std::unordered_map<std::string_view, UdonValue::ManagedString*> symbols;
+};
+
 template <typename T>
 struct ValueHashMap
 {
-	explicit ValueHashMap(size_t initial_buckets = 16)
-	{
-		init_buckets(initial_buckets);
+	// Open addressing with linear probing over a power-of-two table. Hashes are
+	// mixed before use, since hash_value of an int is the int itself: the low
+	// bits pick the slot and tags holds one byte per slot (0 = empty, otherwise
+	// 0x80 | the top 7 hash bits) so probes rarely touch the slots themselves.
+	// erase uses backward shifting, so there are no tombstones. Storage is
+	// allocated on the first insert.
+	explicit ValueHashMap(size_t initial_capacity = 0)
+	{
+		if (initial_capacity > 0)
+			init_slots(capacity_for(initial_capacity));
 	}
 
 	void clear()
 	{
-		buckets.clear();
+		tags.clear();
+		slots.clear();
 		count = 0;
 	}
 
@@ -117,149 +216,167 @@ struct ValueHashMap
 
 	bool contains(const UdonValue& key) const
 	{
-		return find_entry_const(key) != nullptr;
+		return find_slot(key) != npos;
 	}
 
 	T* find(const UdonValue& key)
 	{
-		auto* entry = find_entry_mutable(key);
-		return entry ? &entry->value : nullptr;
+		const size_t idx = find_slot(key);
+		return idx != npos ? &slots[idx].value : nullptr;
 	}
 
 	const T* find(const UdonValue& key) const
 	{
-		auto* entry = find_entry_const(key);
-		return entry ? &entry->value : nullptr;
+		const size_t idx = find_slot(key);
+		return idx != npos ? &slots[idx].value : nullptr;
 	}
 
 	bool set(const UdonValue& key, const T& value)
 	{
 		if (!is_hashable_value(key))
 			return false;
-		maybe_rehash();
-		const size_t h = hash_value(key);
-		auto& bucket = buckets[bucket_index(h)];
-		for (auto& entry : bucket)
+		const size_t h = mixed_hash(key);
+		if (!tags.empty())
 		{
-			if (entry.hash == h && hashable_values_equal(entry.key, key))
+			const size_t idx = probe(key, h);
+			if (tags[idx] != 0)
 			{
-				entry.value = value;
+				slots[idx].value = value;
 				return true;
 			}
 		}
-		bucket.push_back(Entry{ key, value, h });
+		if ((count + 1) * 4 > tags.size() * 3)
+			grow();
+		const size_t idx = probe(key, h);
+		tags[idx] = tag_for(h);
+		slots[idx].key = key;
+		slots[idx].value = value;
+		slots[idx].hash = h;
 		++count;
 		return true;
 	}
 
 	bool erase(const UdonValue& key)
 	{
-		if (!is_hashable_value(key) || buckets.empty())
+		size_t hole = find_slot(key);
+		if (hole == npos)
 			return false;
-		const size_t h = hash_value(key);
-		auto& bucket = buckets[bucket_index(h)];
-		for (size_t i = 0; i < bucket.size(); ++i)
+		const size_t mask = tags.size() - 1;
+		for (size_t next = (hole + 1) & mask; tags[next] != 0; next = (next + 1) & mask)
 		{
-			auto& entry = bucket[i];
-			if (entry.hash == h && hashable_values_equal(entry.key, key))
+			const size_t home = slots[next].hash & mask;
+			if (((next - home) & mask) >= ((next - hole) & mask))
 			{
-				bucket[i] = bucket.back();
-				bucket.pop_back();
-				--count;
-				return true;
+				tags[hole] = tags[next];
+				slots[hole] = std::move(slots[next]);
+				hole = next;
 			}
 		}
-		return false;
+		tags[hole] = 0;
+		slots[hole] = Entry{};
+		--count;
+		return true;
 	}
 
 	template <typename Fn>
 	void for_each(Fn&& fn)
 	{
-		for (auto& bucket : buckets)
+		for (size_t i = 0; i < tags.size(); ++i)
 		{
-			for (auto& entry : bucket)
-			{
-				if (!fn(entry.key, entry.value))
-					return;
-			}
+			if (tags[i] != 0 && !fn(slots[i].key, slots[i].value))
+				return;
 		}
 	}
 
 	struct Entry
 	{
 		UdonValue key;
-		T value;
-		size_t hash;
+		T value{};
+		size_t hash = 0;
 	};
 
-	std::vector<std::vector<Entry>> buckets;
+	static constexpr size_t npos = static_cast<size_t>(-1);
+
+	std::vector<u8> tags;
+	std::vector<Entry> slots;
 	size_t count = 0;
-	const double max_load = 0.75;
 
-	void init_buckets(size_t n)
+	// murmur3's 64-bit finalizer: every input bit reaches the low bits used
+	// for the slot and the high bits used for the tag.
+	static size_t mixed_hash(const UdonValue& key)
+	{
+		u64 h = static_cast<u64>(hash_value(key));
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return static_cast<size_t>(h);
+	}
+
+	static u8 tag_for(size_t h)
 	{
-		if (n < 4)
-			n = 4;
-		buckets.clear();
-		buckets.resize(n);
-		count = 0;
+		return static_cast<u8>(0x80 | (h >> (sizeof(size_t) * 8 - 7)));
 	}
 
-	size_t bucket_index(size_t h) const
+	static size_t capacity_for(size_t n)
 	{
-		UDON_ASSERT(!buckets.empty());
-		return h % buckets.size();
+		size_t cap = 8;
+		while (cap * 3 < n * 4)
+			cap <<= 1;
+		return cap;
 	}
 
-	Entry* find_entry_mutable(const UdonValue& key)
+	void init_slots(size_t cap)
 	{
-		if (!is_hashable_value(key) || buckets.empty())
-			return nullptr;
-		const size_t h = hash_value(key);
-		auto& bucket = buckets[bucket_index(h)];
-		for (auto& entry : bucket)
-		{
-			if (entry.hash == h && hashable_values_equal(entry.key, key))
-				return &entry;
-		}
-		return nullptr;
+		tags.assign(cap, 0);
+		slots.clear();
+		slots.resize(cap);
+		count = 0;
 	}
 
-	const Entry* find_entry_const(const UdonValue& key) const
+	// Returns the slot holding key, or the empty slot where it would go.
+	size_t probe(const UdonValue& key, size_t h) const
 	{
-		if (!is_hashable_value(key) || buckets.empty())
-			return nullptr;
-		const size_t h = hash_value(key);
-		const auto& bucket = buckets[bucket_index(h)];
-		for (const auto& entry : bucket)
+		const size_t mask = tags.size() - 1;
+		const u8 tag = tag_for(h);
+		size_t idx = h & mask;
+		while (tags[idx] != 0)
 		{
-			if (entry.hash == h && hashable_values_equal(entry.key, key))
-				return &entry;
+			if (tags[idx] == tag && slots[idx].hash == h && hashable_values_equal(slots[idx].key, key))
+				return idx;
+			idx = (idx + 1) & mask;
 		}
-		return nullptr;
+		return idx;
 	}
 
-	void maybe_rehash()
+	size_t find_slot(const UdonValue& key) const
 	{
-		if (buckets.empty())
-		{
-			init_buckets(16);
-			return;
-		}
-		if (static_cast<double>(count + 1) <= max_load * static_cast<double>(buckets.size()))
-			return;
-		const size_t new_size = buckets.size() * 2;
-		std::vector<std::vector<Entry>> new_buckets;
-		new_buckets.resize(new_size);
-		for (auto& bucket : buckets)
+		if (count == 0 || !is_hashable_value(key))
+			return npos;
+		const size_t idx = probe(key, mixed_hash(key));
+		return tags[idx] != 0 ? idx : npos;
+	}
+
+	void grow()
+	{
+		std::vector<u8> old_tags;
+		std::vector<Entry> old_slots;
+		old_tags.swap(tags);
+		old_slots.swap(slots);
+		init_slots(old_tags.empty() ? 8 : old_tags.size() * 2);
+		const size_t mask = tags.size() - 1;
+		for (size_t i = 0; i < old_tags.size(); ++i)
 		{
-			for (auto& entry : bucket)
-			{
-				const size_t idx = entry.hash % new_size;
-				new_buckets[idx].push_back(entry);
-			}
+			if (old_tags[i] == 0)
+				continue;
+			size_t idx = old_slots[i].hash & mask;
+			while (tags[idx] != 0)
+				idx = (idx + 1) & mask;
+			tags[idx] = old_tags[i];
+			slots[idx] = std::move(old_slots[i]);
+			++count;
 		}
-		buckets.swap(new_buckets);
 	}
 };
 
@@ -268,11 +385,39 @@ using UdonBuiltinFunction = std::function<bool(struct UdonInterpreter*,
 	UdonValue&,
 	CodeLocation&)>;
 
+// Arguments of a span builtin, read in place: VM2 passes a view of the
+// caller's register window, every other caller a view of its argument vector.
+struct UdonArgs
+{
+	const UdonValue* values = nullptr;
+	size_t count = 0;
+
+	UdonArgs() = default;
+	UdonArgs(const UdonValue* v, size_t n) : values(v), count(n) {}
+	explicit UdonArgs(const std::vector<UdonValue>& v) : values(v.data()), count(v.size()) {}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	const UdonValue& operator[](size_t i) const { return values[i]; }
+	const UdonValue& back() const { return values[count - 1]; }
+	const UdonValue* begin() const { return values; }
+	const UdonValue* end() const { return values + count; }
+};
+
+// The span ABI: no argument vector to fill and no type-erased call. Any
+// captureless lambda taking UdonArgs converts to it, so register_function
+// picks the ABI from the lambda's parameter type.
+using UdonSpanBuiltinFunction = bool (*)(struct UdonInterpreter*,
+	UdonArgs,
+	UdonValue&,
+	CodeLocation&);
+
 struct UdonBuiltinEntry
 {
 	std::string arg_signature;
 	std::string return_type;
-	UdonBuiltinFunction function;
+	UdonBuiltinFunction function; // always callable; adapts span_function when set
+	UdonSpanBuiltinFunction span_function = nullptr;
 };
 
 extern std::vector<std::string> OpcodeNames;
@@ -307,6 +452,9 @@ enum class Opcode
 	LOGICAL_NOT,
 	GET_PROP,
 	STORE_PROP,
+	ITER_NEXT,
+	ITER_KEY,
+	ITER_VALUE,
 	MAKE_CLOSURE,
 	CALL,
 	RETURN,
@@ -339,12 +487,150 @@ struct UdonEnvironment
 {
 	std::vector<UdonValue> slots;
 	UdonEnvironment* parent = nullptr;
+	UdonInterpreter* owner = nullptr; // heap that tracks this environment
+	bool marked = false;
+	bool old = false; // survived a collection
+	bool remembered = false; // old, and in owner's remembered set
+};
+
+// Hidden class of a record-like array: the ordered string keys of its
+// entries. Arrays that gained the same keys in the same order share a shape,
+// so the position of a key in entries is a property of the shape. Shapes live
+// as long as their interpreter and ids are never reused, which lets inline
+// caches hold an id instead of a pointer that might dangle.
+struct UdonShape
+{
+	u64 id = 0;
+	const UdonShape* parent = nullptr;
+	u32 count = 0; // keys, i.e. entries of an array with this shape
+	std::unordered_map<std::string, UdonShape*> transitions; // next key -> shape
+};
+
+// Dense list storage with room at both ends: the elements are
+// items[head, head + count), so taking or adding one at the front moves head
+// instead of every element. Running out of room on either side at least
+// doubles it, which keeps push/pop at both ends amortised O(1). Slots outside
+// the live range hold None.
+struct UdonList
+{
+	std::vector<UdonValue> items;
+	size_t head = 0;
+	size_t count = 0;
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	UdonValue& operator[](size_t i) { return items[head + i]; }
+	const UdonValue& operator[](size_t i) const { return items[head + i]; }
+	UdonValue& front() { return items[head]; }
+	UdonValue& back() { return items[head + count - 1]; }
+	const UdonValue* begin() const { return items.data() + head; }
+	const UdonValue* end() const { return items.data() + head + count; }
+
+	void push_back(const UdonValue& v)
+	{
+		if (head + count == items.size())
+			make_room_back();
+		items[head + count] = v;
+		++count;
+	}
+	void push_front(const UdonValue& v)
+	{
+		if (head == 0)
+			make_room_front();
+		items[--head] = v;
+		++count;
+	}
+	void pop_back()
+	{
+		items[head + --count] = UdonValue();
+		if (count == 0)
+			head = 0;
+	}
+	UdonValue pop_front()
+	{
+		UdonValue v = std::move(items[head++]);
+		if (--count == 0)
+			head = 0;
+		return v;
+	}
+	void clear()
+	{
+		items.clear();
+		head = 0;
+		count = 0;
+	}
+	void release() // clear() and give the memory back
+	{
+		clear();
+		items.shrink_to_fit();
+	}
+
+private:
+	void make_room_back();
+	void make_room_front();
+};
+
+struct UdonValue::ManagedArray
+{
+	struct Entry
+	{
+		UdonValue key;
+		UdonValue value;
+		u64 seq = 0; // insertion number; foreach cursors follow it, not the position
+		bool live = true;
+	};
+
+	// Sets and maps are arrays that are always sparse, keyed by the values
+	// themselves (ints and floats are not turned into strings). They keep
+	// insertion order and never get a shape.
+	enum class Kind : u8
+	{
+		Array,
+		Set, // entry values are all true; foreach yields the keys
+		Map,
+	};
+
+	// List part: while dense, element i lives in list[i] under the key "i" and
+	// entries/index are unused. The first write that is not an overwrite or an
+	// append at "size" (or a delete other than the last element) moves
+	// everything into entries and the array stays sparse until cleared.
+	UdonList list;
+	bool dense = true;
+
+	std::vector<Entry> entries; // insertion order; deleted entries stay as tombstones until compacted
+	u64 next_seq = 0; // seq of the next entry; list element i counts as seq i
+	ValueHashMap<size_t> index; // key -> position in entries
+	size_t size = 0;
+	UdonShape* shape = nullptr; // only while sparse with string keys and no tombstones; null is dictionary mode
+	Kind kind = Kind::Array;
+	UdonInterpreter* owner = nullptr; // heap that tracks this array
 	bool marked = false;
+	bool old = false; // survived a collection
+	bool remembered = false; // old, and in owner's remembered set
+};
+
+struct UdonValue::ManagedFunction
+{
+	std::string function_name;
+	UdonEnvironment* captured_env = nullptr;
+	std::string template_body; // optional payload for native handlers
+	std::shared_ptr<std::vector<UdonInstruction>> code_ptr;
+	std::shared_ptr<std::vector<std::string>> param_ptr;
+	std::shared_ptr<std::vector<s32>> param_slots;
+	size_t root_scope_size = 0;
+	s32 variadic_slot = -1;
+	std::string variadic_param;
+	std::shared_ptr<void> user_data; // optional external payload for native closures
+	UdonBuiltinFunction native_handler; // optional native closure entrypoint
+	std::vector<UdonValue> rooted_values; // values that must stay alive with this function
+	bool marked = false;
+	bool old = false; // survived a collection; functions are only written while still in the nursery
+	u64 magic = 0;
+	bool is_cache_wrapper = false;
 };
 
 struct UdonInterpreter
 {
-	std::unordered_map<std::string, UdonValue> globals;
 	std::unordered_map<std::string, std::shared_ptr<std::vector<UdonInstruction>>> instructions; // by function name
 	std::unordered_map<std::string, std::shared_ptr<std::vector<std::string>>> function_params; // parameter names per function
 	std::unordered_map<std::string, std::string> function_variadic; // variadic param name per function (optional)
@@ -355,26 +641,76 @@ struct UdonInterpreter
 	std::unordered_map<std::string, std::vector<std::string>> event_handlers; // on:event -> function names
 	std::unordered_set<std::string> declared_globals;
 	std::vector<std::string> declared_global_order;
+	// Global storage, indexed by slot; the GC marks it. Hosts read and write
+	// globals by name through get_global_value/set_global_value, or take a
+	// read-only snapshot of all of them with globals().
 	std::vector<UdonValue> global_slots;
+	std::vector<std::string> global_slot_names;
 	std::unordered_map<std::string, s32> global_slot_lookup;
 	std::unordered_map<std::string, US2Function> functions_v2;
+	bool optimize_us2 = true; // run the US2 optimiser on every function compiled for VM2
+	bool vm2_callbacks = true; // invoke_function runs script functions on VM2; off uses the stack interpreter
+	std::string module_cache_dir; // where compile_cached keeps compiled modules; empty disables it
+	std::unique_ptr<UdonInterpreter2> vm2; // persistent VM2 bound to functions_v2, created on first run
 	std::vector<UdonValue> stack;
 	std::vector<UdonEnvironment**> active_env_roots;
 	std::vector<std::vector<UdonValue>*> active_value_roots;
+	std::vector<const UdonInterpreter2*> active_vms; // VM2 instances inside run(); the GC marks their frames
 	std::vector<UdonEnvironment*> heap_environments;
 	std::vector<UdonValue::ManagedArray*> heap_arrays;
 	std::vector<UdonValue::ManagedFunction*> heap_functions;
+	SlabPool<UdonEnvironment> environment_pool; // backing storage for heap_environments
+	SlabPool<UdonValue::ManagedArray> array_pool; // backing storage for heap_arrays
+	SlabPool<UdonValue::ManagedFunction> function_pool; // backing storage for heap_functions
+	UdonSymbolTable symbols; // string constants of translated code; cleared with it by reset_state
+	std::deque<UdonShape> shapes; // front() is the empty shape; kept across reset() (see UdonShape)
+	// Each heap_* vector holds its old objects in front of old_* and the
+	// nursery behind it. Old objects stay marked between collections, so a
+	// minor collection only traces from the roots and the remembered set
+	// (old objects written with a nursery reference since the last one).
+	size_t old_environments = 0;
+	size_t old_arrays = 0;
+	size_t old_functions = 0;
+	std::vector<UdonEnvironment*> remembered_environments;
+	std::vector<UdonValue::ManagedArray*> remembered_arrays;
 
 	u64 gc_runs = 0;
 	u64 gc_time_ms = 0;
+	// Allocation-driven collection, honoured by VM2 at safepoints (calls and
+	// backward jumps). A collection is due once the objects allocated since
+	// the last one reach max(min_debt, live objects * growth_percent / 100).
+	// With generational set that collection only sweeps the nursery; a full
+	// one runs once the objects promoted since the last full collection reach
+	// max(min_debt, old objects * major_growth_percent / 100).
+	struct GcConfig
+	{
+		bool auto_collect = true;
+		bool generational = true;
+		u64 min_debt = 4096;
+		u32 growth_percent = 100;
+		u32 major_growth_percent = 100;
+		u32 time_budget_ms = 0; // 0 = unbounded sweep, full collections only
+	} gc_config;
+	u64 gc_debt_limit = 4096;
+	u64 gc_promoted_limit = 4096;
+	u32 native_call_depth = 0; // builtins on the C++ stack; their locals are not rooted
 	u64 cache_version = 1;
 	struct Stats
 	{
 		u64 opcode_counts[static_cast<size_t>(Opcode::OPCODE_MAX)] = { 0 };
 		u64 resolve_function_by_name_calls = 0;
-		std::vector<u64> opcode2_counts; // sized to VM2 opcode count when VM2 executes
+		std::vector<u64> opcode2_counts; // sized to VM2 opcode count when profiling is on
+		bool profile_opcodes2 = false; // VM2 counts executed opcodes only when set
 		u64 scratch_arena_used = 0;
 		u64 scratch_arena_capacity = 0;
+		u64 gc_alloc_debt = 0; // heap objects allocated since the last collection
+		u64 gc_auto_runs = 0; // collections started by the allocation trigger
+		u64 gc_deferred = 0; // due safepoints skipped because a builtin was active
+		u64 gc_minor_runs = 0;
+		u64 gc_major_runs = 0;
+		u64 gc_promoted = 0; // promoted since the last full collection
+		u64 gc_last_pause_us = 0;
+		u64 gc_max_pause_us = 0;
 	} stats;
 
 	std::vector<void*> dl_handles;
@@ -383,6 +719,12 @@ struct UdonInterpreter
 	s32 lambda_counter = 0;
 	std::unordered_map<std::string, std::vector<std::string>> context_info;
 	std::unordered_map<std::string, UdonValue> function_cache;
+	// Compiled $jsx and $html templates by template text, so evaluating a
+	// template literal again only binds its props. Cleared when it reaches
+	// kTemplateCacheLimit entries (templates built from runtime strings).
+	std::unordered_map<std::string, std::shared_ptr<JsxTemplate>> jsx_templates;
+	std::unordered_map<std::string, std::shared_ptr<HtmlTemplate>> html_templates;
+	static constexpr size_t kTemplateCacheLimit = 1024;
 	std::unordered_map<const std::vector<UdonInstruction>*, u64> code_cache_versions;
 	std::vector<std::vector<UdonValue>> value_buffer_pool;
 	Arena scratch_arena;
@@ -392,6 +734,10 @@ struct UdonInterpreter
 	std::vector<Token> tokenize(const std::string& source_code);
 	CodeLocation compile(const std::string& source_code);
 	CodeLocation compile_append(const std::string& source_code);
+	// compile(), but restores a fresh compiled module from module_cache_dir
+	// when there is one and writes one after compiling otherwise.
+	CodeLocation compile_cached(const std::string& source_code);
+	void publish_context_global();
 	void seed_builtin_globals();
 	void reset_state(bool release_heaps, bool release_handles);
 	CodeLocation run(std::string function_name,
@@ -402,6 +748,9 @@ struct UdonInterpreter
 		UdonValue& return_value);
 	void rebuild_global_slots();
 	s32 get_global_slot(const std::string& name) const;
+	s32 intern_global_slot(const std::string& name);
+	std::vector<std::pair<std::string, UdonValue>> global_values() const; // set globals in slot order
+	std::unordered_map<std::string, UdonValue> globals() const; // name -> value view of global_values(); writes to it are not seen
 	bool get_global_value(const std::string& name, UdonValue& out, s32 slot_hint = -1) const;
 	void set_global_value(const std::string& name, const UdonValue& v, s32 slot_hint = -1);
 	CodeLocation run_eventhandlers(std::string on_event_name);
@@ -411,15 +760,31 @@ struct UdonInterpreter
 		const std::vector<UdonValue>* value_roots = nullptr,
 		u32 time_budget_ms = 0,
 		bool invalidate_caches = false);
+	void collect_nursery(UdonEnvironment* env_root = nullptr,
+		const std::vector<UdonValue>* value_roots = nullptr);
+	void collect_generational(UdonEnvironment* env_root = nullptr,
+		const std::vector<UdonValue>* value_roots = nullptr);
+	bool gc_due() const
+	{
+		return gc_config.auto_collect && stats.gc_alloc_debt >= gc_debt_limit;
+	}
+	void collect_at_safepoint();
 	void register_function(const std::string& name,
 		const std::string& arg_signature,
 		const std::string& return_type,
 		UdonBuiltinFunction fn);
+	void register_function(const std::string& name,
+		const std::string& arg_signature,
+		const std::string& return_type,
+		UdonSpanBuiltinFunction fn);
 	CodeLocation invoke_function(const UdonValue& fn,
 		const std::vector<UdonValue>& positional,
 		UdonValue& out);
 	UdonEnvironment* allocate_environment(size_t slot_count, UdonEnvironment* parent);
 	UdonValue::ManagedArray* allocate_array();
+	UdonShape* root_shape();
+	// from plus key, or null once records get too wide or too many shapes exist
+	UdonShape* shape_transition(UdonShape* from, const std::string& key);
 	UdonValue::ManagedFunction* allocate_function();
 	s32 register_dl_handle(void* handle);
 	void* get_dl_handle(s32 id);
@@ -430,43 +795,50 @@ struct UdonInterpreter
 
 extern thread_local UdonInterpreter* g_udon_current;
 
-struct UdonValue::ManagedArray
+inline bool gc_in_nursery(const UdonValue& v)
 {
-	struct Entry
+	if (v.type == UdonValue::Type::Array)
+		return v.array_map && !v.array_map->old;
+	if (v.type == UdonValue::Type::Function)
+		return v.function && !v.function->old;
+	return false;
+}
+
+// Write barriers: every store of a value into an array or environment goes
+// through one of these so minor collections can find old -> nursery edges.
+inline void gc_write_barrier(UdonValue::ManagedArray* arr, const UdonValue& v)
+{
+	if (arr->old && !arr->remembered && arr->owner && gc_in_nursery(v))
 	{
-		UdonValue key;
-		UdonValue value;
-		Entry* prev = nullptr;
-		Entry* next = nullptr;
-		size_t hash = 0;
-	};
-
-	ValueHashMap<Entry*> index;
-	Entry* head = nullptr;
-	Entry* tail = nullptr;
-	size_t size = 0;
-	bool marked = false;
+		arr->remembered = true;
+		arr->owner->remembered_arrays.push_back(arr);
+	}
+}
 
-	~ManagedArray();
-};
+inline void gc_write_barrier(UdonEnvironment* env, const UdonValue& v)
+{
+	if (env->old && !env->remembered && env->owner && gc_in_nursery(v))
+	{
+		env->remembered = true;
+		env->owner->remembered_environments.push_back(env);
+	}
+}
 
-struct UdonValue::ManagedFunction
+// Marks a builtin/native handler as running: values it holds in C++ locals
+// are invisible to the GC, so safepoint collection waits until it returns.
+struct NativeCallScope
 {
-	std::string function_name;
-	UdonEnvironment* captured_env = nullptr;
-	std::string template_body; // optional payload for native handlers
-	std::shared_ptr<std::vector<UdonInstruction>> code_ptr;
-	std::shared_ptr<std::vector<std::string>> param_ptr;
-	std::shared_ptr<std::vector<s32>> param_slots;
-	size_t root_scope_size = 0;
-	s32 variadic_slot = -1;
-	std::string variadic_param;
-	std::shared_ptr<void> user_data; // optional external payload for native closures
-	UdonBuiltinFunction native_handler; // optional native closure entrypoint
-	std::vector<UdonValue> rooted_values; // values that must stay alive with this function
-	bool marked = false;
-	u64 magic = 0;
-	bool is_cache_wrapper = false;
+	explicit NativeCallScope(UdonInterpreter* interp) : interpreter(interp)
+	{
+		if (interpreter)
+			++interpreter->native_call_depth;
+	}
+	~NativeCallScope()
+	{
+		if (interpreter)
+			--interpreter->native_call_depth;
+	}
+	UdonInterpreter* interpreter = nullptr;
 };
 
 struct ScopedRoot
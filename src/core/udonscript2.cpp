@@ -3,6 +3,7 @@
 #include "udonscript.h"
 
 #include <algorithm>
+#include <atomic>
 #include <unordered_map>
 #include <sstream>
 #include <iostream>
@@ -37,17 +38,54 @@ static bool get_property_value(const UdonValue& obj, const std::string& name, Ud
 	return true;
 }
 
+// Inline cache misses of literal GET_PROP/STORE_PROP: the ordinary lookup,
+// which also records where the object's shape keeps the name.
+static void get_property_cached(const UdonValue& obj, const UdonValue& name, const US2PropSite& site, UdonValue& out)
+{
+	const UdonValue::ManagedArray* arr = obj.type == UdonValue::Type::Array ? obj.array_map : nullptr;
+	if (arr && arr->shape)
+	{
+		if (const size_t* pos = arr->index.find(name))
+		{
+			site.shape_id = arr->shape->id;
+			site.slot = static_cast<u32>(*pos);
+			out = arr->entries[*pos].value;
+			return;
+		}
+	}
+	if (!array_get(obj, name, out))
+		out = make_none();
+}
+
+static void set_property_cached(UdonValue& obj, const UdonValue& name, const UdonValue& value, const US2PropSite& site)
+{
+	const UdonShape* before = obj.type == UdonValue::Type::Array && obj.array_map ? obj.array_map->shape : nullptr;
+	array_set(obj, name, value);
+	const UdonValue::ManagedArray* arr = obj.array_map;
+	if (arr->shape && arr->shape == before) // overwrote a key the shape already had
+	{
+		if (const size_t* pos = arr->index.find(name))
+		{
+			site.shape_id = arr->shape->id;
+			site.slot = static_cast<u32>(*pos);
+		}
+	}
+}
+
 static bool get_index_value(const UdonValue& obj, const UdonValue& index, UdonValue& out)
 {
 	if (obj.type == UdonValue::Type::Array)
 	{
-		if (!array_get(obj, key_from_value(index), out))
+		const bool found = (index.type == UdonValue::Type::Int)
+			? array_get_at(obj, index.int_value, out)
+			: array_get(obj, index.type == UdonValue::Type::String || array_is_table(obj) ? index : make_string(key_from_value(index)), out);
+		if (!found)
 			out = make_none();
 		return true;
 	}
 	if (obj.type == UdonValue::Type::String)
 	{
-		std::string s = obj.string_value;
+		std::string s = obj.string_value();
 		s64 idx = static_cast<s64>(as_number(index));
 		if (idx >= 0 && static_cast<size_t>(idx) < s.size())
 			out = make_string(std::string(1, s[static_cast<size_t>(idx)]));
@@ -57,7 +95,7 @@ static bool get_index_value(const UdonValue& obj, const UdonValue& index, UdonVa
 	}
 	if (index.type == UdonValue::Type::String)
 	{
-		return get_property_value(obj, index.string_value, out);
+		return get_property_value(obj, index.string_value(), out);
 	}
 
 	out = make_none();
@@ -92,13 +130,74 @@ struct StackSlotAllocator
 	}
 };
 
-static US2Instruction make_loadk(s32 dst, const UdonValue& lit)
+// Collects translated instructions together with the side tables of the
+// function they belong to.
+struct US2Emitter
+{
+	US2Code& code;
+	US2Function& fn;
+	UdonSymbolTable& symbols;
+	US2SourcePos pos{}; // of the legacy instruction being translated
+
+	size_t size() const { return code.size(); }
+	US2Instruction& operator[](size_t i) { return code[i]; }
+	void push_back(const US2Instruction& in)
+	{
+		code.push_back(in);
+		fn.tables->positions.push_back(pos);
+	}
+	u32 constant(const UdonValue& v) { return us2_add_constant(fn, symbols.intern(v)); }
+	u32 call_site(const std::string& callee_name, s32 argc)
+	{
+		US2CallSite site{};
+		site.callee_name = callee_name;
+		site.argc = argc;
+		fn.tables->call_sites.push_back(std::move(site));
+		return static_cast<u32>(fn.tables->call_sites.size() - 1);
+	}
+	s32 prop_site()
+	{
+		fn.tables->prop_sites.emplace_back();
+		return static_cast<s32>(fn.tables->prop_sites.size() - 1);
+	}
+};
+
+u32 us2_add_constant(US2Function& fn, const UdonValue& v)
+{
+	fn.tables->constants.push_back(v);
+	return static_cast<u32>(fn.tables->constants.size() - 1);
+}
+
+void us2_mark_tail_calls(US2Function& fn)
+{
+	if (!fn.code || !fn.tables)
+		return;
+	const US2Code& code = *fn.code;
+	for (size_t i = 0; i < code.size(); ++i)
+	{
+		if (code[i].opcode != Opcode2::CALL)
+			continue;
+		const US2ValueRef dst = code[i].dst;
+		const US2Instruction* next = i + 1 < code.size() ? &code[i + 1] : nullptr;
+		fn.tables->call_sites[code[i].k].tail = next && next->opcode == Opcode2::RETURN &&
+			dst.frame_depth == 0 && next->a.frame_depth == 0 && next->a.index == dst.index;
+	}
+}
+
+US2SourcePos us2_position(const US2Function& fn, size_t ip)
+{
+	if (!fn.tables || ip >= fn.tables->positions.size())
+		return US2SourcePos{};
+	return fn.tables->positions[ip];
+}
+
+static US2Instruction make_loadk(s32 dst, u32 k)
 {
 	US2Instruction o{};
 	o.opcode = Opcode2::LOADK;
 	o.dst = { 0, dst };
 	o.has_literal = true;
-	o.literal = lit;
+	o.k = k;
 	return o;
 }
 
@@ -112,15 +211,28 @@ static US2Instruction make_bin(Opcode2 op, s32 dst, s32 lhs, s32 rhs)
 	return o;
 }
 
-static bool translate_instruction(const UdonInstruction& in,
+// A local ref has to fit US2ValueRef's bit fields; truncating it would
+// address another frame's slot.
+static bool local_ref_fits(const UdonInstruction& in, s32 depth, s32 slot, CodeLocation& err)
+{
+	if (depth >= 0 && depth <= kUS2MaxFrameDepth && slot <= kUS2MaxSlots)
+		return true;
+	err.has_error = true;
+	err.opt_error_message = "udonscript2: local is nested more than " + std::to_string(kUS2MaxFrameDepth) + " scopes out";
+	err.line = in.line;
+	err.column = in.column;
+	return false;
+}
+
+static bool translate_instruction(UdonInterpreter& interp,
+	const UdonInstruction& in,
 	StackSlotAllocator& slots,
-	std::vector<US2Instruction>& out,
+	US2Emitter& out,
 	std::vector<int>& last_def,
 	CodeLocation& err)
 {
 	US2Instruction o{};
-	o.line = in.line;
-	o.column = in.column;
+	out.pos = { in.line, in.column };
 	auto ensure_last = [&](s32 slot)
 	{
 		if (slot < 0)
@@ -139,7 +251,7 @@ static bool translate_instruction(const UdonInstruction& in,
 		case Opcode::PUSH_LITERAL:
 		{
 			s32 dst = slots.push();
-			o = make_loadk(dst, in.operands.empty() ? make_none() : in.operands[0]);
+			o = make_loadk(dst, out.constant(in.operands.empty() ? make_none() : in.operands[0]));
 			out.push_back(o);
 			ensure_last(dst);
 			last_def[static_cast<size_t>(dst)] = static_cast<int>(out.size() - 1);
@@ -159,12 +271,12 @@ static bool translate_instruction(const UdonInstruction& in,
 		}
 		case Opcode::MAKE_CLOSURE:
 		{
-			std::string name = !in.operands.empty() ? in.operands[0].string_value : "";
+			std::string name = !in.operands.empty() ? in.operands[0].string_value() : "";
 			s32 dst = slots.push();
 			o.opcode = Opcode2::MAKE_CLOSURE;
 			o.dst = { 0, dst };
 			o.has_literal = true;
-			o.literal = make_string(name);
+			o.k = out.constant(make_string(name));
 			out.push_back(o);
 			ensure_last(dst);
 			last_def[static_cast<size_t>(dst)] = static_cast<int>(out.size() - 1);
@@ -174,6 +286,8 @@ static bool translate_instruction(const UdonInstruction& in,
 		{
 			s32 depth = in.operands.size() > 0 ? static_cast<s32>(in.operands[0].int_value) : 0;
 			s32 src_slot = in.operands.size() > 1 ? static_cast<s32>(in.operands[1].int_value) : 0;
+			if (!local_ref_fits(in, depth, src_slot, err))
+				return false;
 			s32 dst = slots.push();
 			o.opcode = Opcode2::MOVE;
 			o.dst = { 0, dst };
@@ -187,29 +301,34 @@ static bool translate_instruction(const UdonInstruction& in,
 		{
 			s32 depth = in.operands.size() > 0 ? static_cast<s32>(in.operands[0].int_value) : 0;
 			s32 dst_slot = in.operands.size() > 1 ? static_cast<s32>(in.operands[1].int_value) : 0;
+			if (!local_ref_fits(in, depth, dst_slot, err))
+				return false;
 			s32 src = slots.pop();
 			if (src < 0)
 				src = 0;
-			bool rewritten = false;
+			int defined_at = -1;
 			if (static_cast<size_t>(src) < last_def.size() && last_def[static_cast<size_t>(src)] >= 0)
 			{
 				const size_t def_idx = static_cast<size_t>(last_def[static_cast<size_t>(src)]);
 				if (def_idx < out.size())
 				{
 					out[def_idx].dst = { depth, dst_slot };
-					rewritten = true;
-					last_def[static_cast<size_t>(dst_slot)] = static_cast<int>(def_idx);
+					defined_at = static_cast<int>(def_idx);
 				}
 			}
 			clear_last(src);
-			if (!rewritten)
+			if (defined_at < 0)
 			{
 				o.opcode = Opcode2::MOVE;
 				o.dst = { depth, dst_slot };
 				o.a = { 0, src };
 				out.push_back(o);
+				defined_at = static_cast<int>(out.size() - 1);
+			}
+			if (depth == 0 && dst_slot >= 0) // slots of enclosing frames are not tracked here
+			{
 				ensure_last(dst_slot);
-				last_def[static_cast<size_t>(dst_slot)] = static_cast<int>(out.size() - 1);
+				last_def[static_cast<size_t>(dst_slot)] = defined_at;
 			}
 			return true;
 		}
@@ -219,8 +338,9 @@ static bool translate_instruction(const UdonInstruction& in,
 			s32 dst = slots.push();
 			o.opcode = Opcode2::LOAD_GLOBAL;
 			o.dst = { 0, dst };
-			o.has_literal = !in.operands.empty();
-			o.literal = in.operands.empty() ? make_string("") : in.operands[0];
+			o.has_literal = true;
+			o.k = out.constant(in.operands.empty() ? make_string("") : in.operands[0]);
+			o.b = { 0, interp.intern_global_slot(out.fn.tables->constants[o.k].string_value()) };
 			out.push_back(o);
 			ensure_last(dst);
 			last_def[static_cast<size_t>(dst)] = static_cast<int>(out.size() - 1);
@@ -235,8 +355,9 @@ static bool translate_instruction(const UdonInstruction& in,
 			clear_last(src);
 			o.opcode = Opcode2::STORE_GLOBAL;
 			o.a = { 0, src };
-			o.has_literal = !in.operands.empty();
-			o.literal = in.operands.empty() ? make_string("") : in.operands[0];
+			o.has_literal = true;
+			o.k = out.constant(in.operands.empty() ? make_string("") : in.operands[0]);
+			o.b = { 0, interp.intern_global_slot(out.fn.tables->constants[o.k].string_value()) };
 			out.push_back(o);
 			return true;
 		}
@@ -284,7 +405,7 @@ static bool translate_instruction(const UdonInstruction& in,
 		}
 		case Opcode::GET_PROP:
 		{
-			std::string name = !in.operands.empty() ? in.operands[0].string_value : "";
+			std::string name = !in.operands.empty() ? in.operands[0].string_value() : "";
 			if (name == "[index]")
 			{
 				s32 idx_slot = slots.pop();
@@ -307,8 +428,9 @@ static bool translate_instruction(const UdonInstruction& in,
 			o.opcode = Opcode2::GET_PROP;
 			o.dst = { 0, dst };
 			o.a = { 0, obj_slot };
+			o.b = { 0, out.prop_site() };
 			o.has_literal = true;
-			o.literal = make_string(name);
+			o.k = out.constant(make_string(name));
 			out.push_back(o);
 			ensure_last(dst);
 			last_def[static_cast<size_t>(dst)] = static_cast<int>(out.size() - 1);
@@ -316,7 +438,7 @@ static bool translate_instruction(const UdonInstruction& in,
 		}
 		case Opcode::STORE_PROP:
 		{
-			std::string name = !in.operands.empty() ? in.operands[0].string_value : "";
+			std::string name = !in.operands.empty() ? in.operands[0].string_value() : "";
 			s32 value_slot = slots.pop();
 			clear_last(value_slot);
 			if (name == "[index]")
@@ -337,11 +459,32 @@ static bool translate_instruction(const UdonInstruction& in,
 			o.opcode = Opcode2::STORE_PROP;
 			o.dst = { 0, obj_slot };
 			o.a = { 0, value_slot };
+			o.b = { 0, out.prop_site() };
 			o.has_literal = true;
-			o.literal = make_string(name);
+			o.k = out.constant(make_string(name));
 			out.push_back(o);
 			return true;
 		}
+		case Opcode::ITER_NEXT:
+		case Opcode::ITER_KEY:
+		case Opcode::ITER_VALUE:
+		{
+			s32 cursor = slots.pop();
+			s32 coll = slots.pop();
+			clear_last(cursor);
+			clear_last(coll);
+			s32 dst = slots.push();
+			Opcode2 op2 = Opcode2::ITER_NEXT;
+			if (in.opcode_instruction == Opcode::ITER_KEY)
+				op2 = Opcode2::ITER_KEY;
+			else if (in.opcode_instruction == Opcode::ITER_VALUE)
+				op2 = Opcode2::ITER_VALUE;
+			o = make_bin(op2, dst, coll, cursor);
+			out.push_back(o);
+			ensure_last(dst);
+			last_def[static_cast<size_t>(dst)] = static_cast<int>(out.size() - 1);
+			return true;
+		}
 		case Opcode::EQ:
 		case Opcode::NEQ:
 		case Opcode::LT:
@@ -450,7 +593,7 @@ static bool translate_instruction(const UdonInstruction& in,
 		case Opcode::CALL:
 		{
 			s32 argc = in.operands.size() > 1 ? static_cast<s32>(in.operands[1].int_value) : 0;
-			std::string name = in.operands.empty() ? "" : in.operands[0].string_value;
+			std::string name = in.operands.empty() ? "" : in.operands[0].string_value();
 			s32 base_slot = slots.next_slot - argc;
 			if (base_slot < 0)
 				base_slot = 0;
@@ -464,21 +607,18 @@ static bool translate_instruction(const UdonInstruction& in,
 			s32 dst = slots.push();
 			o.opcode = Opcode2::CALL;
 			o.dst = { 0, dst };
-			o.literal = make_int(argc);
-			o.has_literal = true;
+			o.k = out.call_site(name, argc);
 			if (name.empty())
 			{
 				if (callable_slot < 0)
 					callable_slot = 0;
 				o.a = { 0, callable_slot }; // callable
 				o.b = { 0, base_slot }; // arg base
-				o.callee_name = "";
 			}
 			else
 			{
 				o.a = { 0, base_slot };
 				o.b = { 0, 0 };
-				o.callee_name = name;
 			}
 			out.push_back(o);
 			ensure_last(dst);
@@ -510,7 +650,16 @@ static bool translate_instruction(const UdonInstruction& in,
 	}
 }
 
+static US2Instruction return_none_instruction()
+{
+	US2Instruction in{};
+	in.opcode = Opcode2::RETURN;
+	in.a = US2ValueRef{ -1, -1 }; // no source: returns none
+	return in;
+}
+
 bool compile_to_us2(
+	UdonInterpreter& interp,
 	const std::string& fn_name,
 	const std::vector<UdonInstruction>& legacy,
 	size_t legacy_frame_size,
@@ -521,6 +670,8 @@ bool compile_to_us2(
 	StackSlotAllocator slots(static_cast<s32>(legacy_frame_size));
 	std::vector<US2Instruction> code;
 	code.reserve(legacy.size());
+	out_fn.tables = std::make_shared<US2Tables>();
+	US2Emitter emitter{ code, out_fn, interp.symbols };
 	std::vector<int> last_def(static_cast<size_t>(legacy_frame_size), -1);
 	std::unordered_map<size_t, s32> slot_overrides;
 	std::vector<int> legacy_to_code(legacy.size(), -1);
@@ -555,7 +706,7 @@ bool compile_to_us2(
 			continue; // ignore scope markers in VM2
 
 		const size_t before_emit = code.size();
-		if (!translate_instruction(instr, slots, code, last_def, err))
+		if (!translate_instruction(interp, instr, slots, emitter, last_def, err))
 			return false;
 		const size_t after_emit = code.size();
 
@@ -588,45 +739,336 @@ bool compile_to_us2(
 		code[jf.code_index].jump_target = legacy_to_code[static_cast<size_t>(jf.legacy_target)];
 	}
 
+	// Falling off the end returns none; an explicit trailing RETURN lets the
+	// dispatcher skip the end-of-code check per instruction.
+	emitter.push_back(return_none_instruction());
+
+	if (slots.max_slot > kUS2MaxSlots)
+	{
+		err.has_error = true;
+		err.opt_error_message = "udonscript2: function '" + fn_name + "' needs too many slots";
+		return false;
+	}
 	out_fn.code = std::make_shared<US2Code>(std::move(code));
 	out_fn.frame_size = static_cast<size_t>(slots.max_slot);
+	out_fn.local_slots = legacy_frame_size;
 	out_fn.result_slot = 0;
 	out_fn.name = fn_name;
+	us2_mark_tail_calls(out_fn);
 	return true;
 }
 
+// A closure at nesting level `depth` reaches the analysed function's
+// environment through any local access `depth` or more levels up.
+static bool closure_reaches_outward(
+	const std::unordered_map<std::string, std::shared_ptr<std::vector<UdonInstruction>>>& code_by_name,
+	const std::string& name,
+	s64 depth)
+{
+	auto it = code_by_name.find(name);
+	if (it == code_by_name.end() || !it->second || depth > 64)
+		return true;
+	for (const auto& in : *it->second)
+	{
+		switch (in.opcode_instruction)
+		{
+			case Opcode::LOAD_LOCAL:
+			case Opcode::STORE_LOCAL:
+				if (!in.operands.empty() && in.operands[0].int_value >= depth)
+					return true;
+				break;
+			case Opcode::MAKE_CLOSURE:
+				if (closure_reaches_outward(code_by_name, in.operands.empty() ? "" : in.operands[0].string_value(), depth + 1))
+					return true;
+				break;
+			default:
+				break;
+		}
+	}
+	return false;
+}
+
+bool us2_needs_environment(
+	const std::vector<UdonInstruction>& legacy,
+	const std::unordered_map<std::string, std::shared_ptr<std::vector<UdonInstruction>>>& code_by_name)
+{
+	for (const auto& in : legacy)
+	{
+		if (in.opcode_instruction != Opcode::MAKE_CLOSURE)
+			continue;
+		if (closure_reaches_outward(code_by_name, in.operands.empty() ? "" : in.operands[0].string_value(), 1))
+			return true;
+	}
+	return false;
+}
+
 void UdonInterpreter2::register_function(const std::string& name, const US2Function& fn)
 {
 	functions[name] = fn;
+	invalidate_links();
 }
 
-static UdonValue* resolve_ref(UdonInterpreter2& vm, const US2ValueRef& ref, const US2Frame* current_frame = nullptr)
+const US2Function* UdonInterpreter2::find_function(const std::string& name) const
 {
-	if (ref.frame_depth < 0 || ref.index < 0)
-		return nullptr;
-	if (ref.frame_depth == 0 && current_frame)
+	auto it = functions.find(name);
+	if (it != functions.end())
+		return &it->second;
+	if (host_functions)
 	{
-		const size_t slot = current_frame->base + static_cast<size_t>(ref.index);
-		return (slot < vm.value_stack.size()) ? &vm.value_stack[slot] : nullptr;
+		auto hit = host_functions->find(name);
+		if (hit != host_functions->end())
+			return &hit->second;
 	}
-	if (ref.frame_depth >= static_cast<s32>(vm.call_stack.size()))
+	return nullptr;
+}
+
+const std::unordered_map<std::string, US2Function>& UdonInterpreter2::function_table() const
+{
+	return host_functions ? *host_functions : functions;
+}
+
+const US2Function* us2_function_for(
+	const std::unordered_map<std::string, US2Function>& table,
+	const UdonValue::ManagedFunction* fn)
+{
+	if (!fn || fn->native_handler || !fn->code_ptr)
 		return nullptr;
-	const size_t frame_idx = vm.call_stack.size() - 1 - static_cast<size_t>(ref.frame_depth);
-	const US2Frame& frame = vm.call_stack[frame_idx];
-	const size_t slot = frame.base + static_cast<size_t>(ref.index);
-	if (slot >= vm.value_stack.size())
+	auto it = table.find(fn->function_name);
+	if (it == table.end() || it->second.legacy_code != fn->code_ptr.get())
 		return nullptr;
-	return &vm.value_stack[slot];
+	return &it->second;
 }
 
-static US2Frame* frame_for_ref(UdonInterpreter2& vm, const US2ValueRef& ref, US2Frame* current_frame = nullptr)
+// Segments start small and double up to a cap, so a shallow script does not
+// pay for a deep one's stack.
+constexpr size_t kUS2FirstSegmentSlots = 1024;
+constexpr size_t kUS2MaxSegmentSlots = 64 * 1024;
+
+US2StackMark US2ValueStack::mark() const
 {
-	if (ref.frame_depth == 0 && current_frame)
-		return current_frame;
-	if (ref.frame_depth < 0 || static_cast<size_t>(ref.frame_depth) >= vm.call_stack.size())
+	US2StackMark m{};
+	m.segment = static_cast<u32>(top);
+	m.used = top < segments.size() ? static_cast<u32>(segments[top].used) : 0;
+	return m;
+}
+
+UdonValue* US2ValueStack::push(size_t count)
+{
+	if (count == 0)
 		return nullptr;
-	const size_t frame_idx = vm.call_stack.size() - 1 - static_cast<size_t>(ref.frame_depth);
-	return &vm.call_stack[frame_idx];
+	for (; top < segments.size(); ++top)
+	{
+		Segment& seg = segments[top];
+		if (seg.slots.size() - seg.used >= count)
+		{
+			UdonValue* window = seg.slots.data() + seg.used;
+			seg.used += count;
+			return window;
+		}
+	}
+	size_t slots = segments.empty() ? kUS2FirstSegmentSlots : std::min(segments.back().slots.size() * 2, kUS2MaxSegmentSlots);
+	Segment seg;
+	seg.slots.assign(std::max(slots, count), make_none());
+	seg.used = count;
+	segments.push_back(std::move(seg)); // moving a Segment keeps its slot storage in place
+	top = segments.size() - 1;
+	return segments.back().slots.data();
+}
+
+void US2ValueStack::release(const US2StackMark& to)
+{
+	for (size_t i = to.segment; i < segments.size() && i <= top; ++i)
+	{
+		Segment& seg = segments[i];
+		const size_t floor = (i == to.segment) ? std::min<size_t>(to.used, seg.used) : 0;
+		std::fill(seg.slots.begin() + static_cast<std::ptrdiff_t>(floor),
+			seg.slots.begin() + static_cast<std::ptrdiff_t>(seg.used), make_none());
+		seg.used = floor;
+	}
+	top = to.segment;
+}
+
+void US2ValueStack::clear()
+{
+	segments.clear();
+	top = 0;
+}
+
+void UdonInterpreter2::reset()
+{
+	value_stack.clear();
+	call_stack.clear();
+	frame_floor = 0;
+	invalidate_links();
+}
+
+void UdonInterpreter2::invalidate_links()
+{
+	link_epoch = 0;
+	linked_host = nullptr;
+}
+
+void UdonInterpreter2::sync_link(const UdonInterpreter* host)
+{
+	static std::atomic<u64> next_epoch{ 0 };
+	const u64 version = host ? host->cache_version : 0;
+	if (link_epoch != 0 && host == linked_host && version == linked_cache_version)
+		return;
+	link_epoch = next_epoch.fetch_add(1) + 1;
+	linked_host = host;
+	linked_cache_version = version;
+}
+
+static void link_call(const UdonInterpreter2& vm, UdonInterpreter* host, const US2CallSite& site)
+{
+	site.link_epoch = vm.link_epoch;
+	site.callee_fn = nullptr;
+	site.callee_builtin = nullptr;
+	site.callee_span = nullptr;
+	site.ic_code = nullptr;
+	site.ic_fn = nullptr;
+	if (site.callee_name.empty())
+	{
+		site.call_kind = US2CallKind::Dynamic;
+		return;
+	}
+	if ((site.callee_fn = vm.find_function(site.callee_name)))
+	{
+		site.call_kind = US2CallKind::Script;
+		return;
+	}
+	site.call_kind = US2CallKind::Host;
+	if (host)
+	{
+		auto bit = host->builtins.find(site.callee_name);
+		if (bit != host->builtins.end())
+		{
+			site.call_kind = US2CallKind::Builtin;
+			site.callee_builtin = &bit->second.function;
+			site.callee_span = bit->second.span_function;
+		}
+	}
+}
+
+// Depth 0 is the frame itself: its environment when it has one (closures
+// share it), its registers otherwise. Deeper refs walk the lexical chain of a
+// closure frame, starting at the environment the closure captured.
+static UdonEnvironment* env_for_ref(const US2Frame& frame, s32 depth)
+{
+	if (depth == 0)
+		return frame.env;
+	UdonEnvironment* env = frame.outer;
+	for (s32 i = 1; i < depth && env; ++i)
+		env = env->parent;
+	return env;
+}
+
+static UdonValue* resolve_ref(const US2ValueRef& ref, const US2Frame& frame)
+{
+	if (ref.frame_depth < 0 || ref.index < 0)
+		return nullptr;
+	const size_t idx = static_cast<size_t>(ref.index);
+	if (ref.frame_depth == 0 && !frame.env)
+		return idx < frame.size ? frame.regs + idx : nullptr;
+	UdonEnvironment* env = env_for_ref(frame, ref.frame_depth);
+	return (env && idx < env->slots.size()) ? &env->slots[idx] : nullptr;
+}
+
+// Quickening. A generic arithmetic or compare instruction that sees two Ints
+// (or two Floats) is rewritten in place to its specialised form; the
+// specialised handler checks the types again and rewrites the instruction
+// back when they no longer match. Sites that keep flipping stay generic.
+constexpr u8 kMaxDequickens = 4;
+
+static Opcode2 quickened_form(Opcode2 generic, const UdonValue& lhs, const UdonValue& rhs)
+{
+	const bool ints = lhs.type == UdonValue::Type::Int && rhs.type == UdonValue::Type::Int;
+	const bool floats = lhs.type == UdonValue::Type::Float && rhs.type == UdonValue::Type::Float;
+	if (!ints && !floats)
+		return generic;
+	switch (generic)
+	{
+		case Opcode2::ADD:
+			return ints ? Opcode2::ADD_INT : Opcode2::ADD_FLOAT;
+		case Opcode2::SUB:
+			return ints ? Opcode2::SUB_INT : Opcode2::SUB_FLOAT;
+		case Opcode2::MUL:
+			return ints ? Opcode2::MUL_INT : Opcode2::MUL_FLOAT;
+		case Opcode2::EQ:
+			return ints ? Opcode2::EQ_INT : generic;
+		case Opcode2::NEQ:
+			return ints ? Opcode2::NEQ_INT : generic;
+		case Opcode2::LT:
+			return ints ? Opcode2::LT_INT : Opcode2::LT_FLOAT;
+		case Opcode2::LTE:
+			return ints ? Opcode2::LTE_INT : Opcode2::LTE_FLOAT;
+		case Opcode2::GT:
+			return ints ? Opcode2::GT_INT : Opcode2::GT_FLOAT;
+		case Opcode2::GTE:
+			return ints ? Opcode2::GTE_INT : Opcode2::GTE_FLOAT;
+		default:
+			return generic;
+	}
+}
+
+Opcode2 us2_generic_form(Opcode2 quick)
+{
+	switch (quick)
+	{
+		case Opcode2::ADD_INT:
+		case Opcode2::ADD_FLOAT:
+			return Opcode2::ADD;
+		case Opcode2::SUB_INT:
+		case Opcode2::SUB_FLOAT:
+			return Opcode2::SUB;
+		case Opcode2::MUL_INT:
+		case Opcode2::MUL_FLOAT:
+			return Opcode2::MUL;
+		case Opcode2::EQ_INT:
+			return Opcode2::EQ;
+		case Opcode2::NEQ_INT:
+			return Opcode2::NEQ;
+		case Opcode2::LT_INT:
+		case Opcode2::LT_FLOAT:
+			return Opcode2::LT;
+		case Opcode2::LTE_INT:
+		case Opcode2::LTE_FLOAT:
+			return Opcode2::LTE;
+		case Opcode2::GT_INT:
+		case Opcode2::GT_FLOAT:
+			return Opcode2::GT;
+		case Opcode2::GTE_INT:
+		case Opcode2::GTE_FLOAT:
+			return Opcode2::GTE;
+		default:
+			return quick;
+	}
+}
+
+// The code vector is owned non-const by its US2Function; only the opcode and
+// its decoded handler change, so a rewrite is safe mid-dispatch.
+static void rewrite_opcode(const US2Function& fn, const US2Instruction& in, Opcode2 to)
+{
+	US2Instruction& target = const_cast<US2Instruction&>(in);
+	target.opcode = to;
+	if (fn.decoded_for)
+		target.handler = fn.decoded_for[static_cast<size_t>(to)];
+}
+
+static void maybe_quicken(const US2Function& fn, const US2Instruction& in, const UdonValue& lhs, const UdonValue& rhs)
+{
+	if (in.dequickens >= kMaxDequickens)
+		return;
+	const Opcode2 quick = quickened_form(in.opcode, lhs, rhs);
+	if (quick != in.opcode)
+		rewrite_opcode(fn, in, quick);
+}
+
+static void dequicken(const US2Function& fn, const US2Instruction& in)
+{
+	if (in.dequickens < kMaxDequickens)
+		in.dequickens++;
+	rewrite_opcode(fn, in, us2_generic_form(in.opcode));
 }
 
 const char* opcode2_name(Opcode2 op)
@@ -667,6 +1109,12 @@ const char* opcode2_name(Opcode2 op)
 			return "GET_PROP";
 		case Opcode2::STORE_PROP:
 			return "STORE_PROP";
+		case Opcode2::ITER_NEXT:
+			return "ITER_NEXT";
+		case Opcode2::ITER_KEY:
+			return "ITER_KEY";
+		case Opcode2::ITER_VALUE:
+			return "ITER_VALUE";
 		case Opcode2::MAKE_CLOSURE:
 			return "MAKE_CLOSURE";
 		case Opcode2::EQ:
@@ -689,31 +1137,125 @@ const char* opcode2_name(Opcode2 op)
 			return "CALL";
 		case Opcode2::RETURN:
 			return "RETURN";
+		case Opcode2::ADD_INT:
+			return "ADD_INT";
+		case Opcode2::ADD_FLOAT:
+			return "ADD_FLOAT";
+		case Opcode2::SUB_INT:
+			return "SUB_INT";
+		case Opcode2::SUB_FLOAT:
+			return "SUB_FLOAT";
+		case Opcode2::MUL_INT:
+			return "MUL_INT";
+		case Opcode2::MUL_FLOAT:
+			return "MUL_FLOAT";
+		case Opcode2::EQ_INT:
+			return "EQ_INT";
+		case Opcode2::NEQ_INT:
+			return "NEQ_INT";
+		case Opcode2::LT_INT:
+			return "LT_INT";
+		case Opcode2::LT_FLOAT:
+			return "LT_FLOAT";
+		case Opcode2::LTE_INT:
+			return "LTE_INT";
+		case Opcode2::LTE_FLOAT:
+			return "LTE_FLOAT";
+		case Opcode2::GT_INT:
+			return "GT_INT";
+		case Opcode2::GT_FLOAT:
+			return "GT_FLOAT";
+		case Opcode2::GTE_INT:
+			return "GTE_INT";
+		case Opcode2::GTE_FLOAT:
+			return "GTE_FLOAT";
 		case Opcode2::HALT:
 			return "HALT";
 	}
 	return "<unknown>";
 }
 
+// Opcode2 in declaration order; the computed-goto handler tables are built from it.
+#define UDON_VM2_OPCODES(X) \
+	X(NOP) X(MOVE) X(LOADK) X(POP) X(LOAD_GLOBAL) X(STORE_GLOBAL) \
+	X(ADD) X(SUB) X(CONCAT) X(MUL) X(DIV) X(MOD) X(NEGATE) X(TO_BOOL) X(LOGICAL_NOT) \
+	X(GET_PROP) X(STORE_PROP) X(ITER_NEXT) X(ITER_KEY) X(ITER_VALUE) X(MAKE_CLOSURE) \
+	X(EQ) X(NEQ) X(LT) X(LTE) X(GT) X(GTE) X(JUMP) X(JUMP_IF_FALSE) X(CALL) X(RETURN) \
+	X(ADD_INT) X(ADD_FLOAT) X(SUB_INT) X(SUB_FLOAT) X(MUL_INT) X(MUL_FLOAT) X(EQ_INT) X(NEQ_INT) \
+	X(LT_INT) X(LT_FLOAT) X(LTE_INT) X(LTE_FLOAT) X(GT_INT) X(GT_FLOAT) X(GTE_INT) X(GTE_FLOAT) X(HALT)
+
+#if UDON_VM2_COMPUTED_GOTO
+// Handlers end in VM2_NEXT() outside their own block, so their locals are
+// destroyed before jumping: a computed goto does not run destructors.
+#define VM2_OP(name) \
+	case Opcode2::name:  \
+	op_##name
+#define VM2_NEXT()                \
+	{                             \
+		op = &code_base[fr.ip];   \
+		goto* op->handler;        \
+	}
+#define VM2_HANDLER(name) &&op_##name,
+#define VM2_COUNTING_HANDLER(name) &&count_##name,
+#define VM2_COUNT_STUB(name)                                            \
+	count_##name : host->stats.opcode2_counts[static_cast<size_t>(Opcode2::name)]++; \
+	goto op_##name;
+
+// Fills in the handler address of every instruction. Redone whenever the
+// table changes (opcode profiling toggled). Code that can fall off its end
+// gets a trailing RETURN so dispatch never needs a bounds check.
+static void decode_us2_code(const US2Function& fn, const void* const* table)
+{
+	US2Code& code = *fn.code;
+	if (code.empty() || (code.back().opcode != Opcode2::RETURN && code.back().opcode != Opcode2::HALT))
+		code.push_back(return_none_instruction());
+	for (auto& in : code)
+		in.handler = table[static_cast<size_t>(in.opcode)];
+	fn.decoded_for = table;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic" // labels as values
+#else
+#define VM2_OP(name) case Opcode2::name
+#define VM2_NEXT() break
+#endif
+
 CodeLocation UdonInterpreter2::run(const std::string& function_name,
 	std::vector<UdonValue> args,
 	UdonValue& return_value)
 {
-	CodeLocation err{};
-	err.has_error = false;
-	constexpr bool kDebugCalls = false;
-	auto fit = functions.find(function_name);
-	if (fit == functions.end())
+	const US2Function* fn = find_function(function_name);
+	if (!fn)
 	{
+		CodeLocation err{};
 		err.has_error = true;
 		err.opt_error_message = "Function '" + function_name + "' not found";
 		return err;
 	}
+	return call(*fn, nullptr, args, return_value);
+}
+
+CodeLocation UdonInterpreter2::call(const US2Function& entry_fn,
+	UdonEnvironment* outer,
+	const std::vector<UdonValue>& args,
+	UdonValue& return_value)
+{
+	CodeLocation err{};
+	err.has_error = false;
+	constexpr bool kDebugCalls = false;
+	const US2Function* fn = &entry_fn;
 
 	auto fail = [&](const std::string& msg) -> CodeLocation
 	{
 		err.has_error = true;
 		err.opt_error_message = msg;
+		if (call_stack.size() > frame_floor && call_stack.back().fn)
+		{
+			const US2SourcePos pos = us2_position(*call_stack.back().fn, call_stack.back().ip);
+			err.line = pos.line;
+			err.column = pos.column;
+		}
 		return err;
 	};
 
@@ -723,11 +1265,26 @@ CodeLocation UdonInterpreter2::run(const std::string& function_name,
 	};
 
 	UdonInterpreter* host = g_udon_current;
-	if (host && host->stats.opcode2_counts.size() < kOpcode2Count)
+	if (host && host->stats.profile_opcodes2 && host->stats.opcode2_counts.size() < kOpcode2Count)
 		host->stats.opcode2_counts.assign(kOpcode2Count, 0);
+#if UDON_VM2_COMPUTED_GOTO
+	static const void* const kHandlers[] = { UDON_VM2_OPCODES(VM2_HANDLER) };
+	static const void* const kCountingHandlers[] = { UDON_VM2_OPCODES(VM2_COUNTING_HANDLER) };
+	static_assert(sizeof(kHandlers) / sizeof(kHandlers[0]) == kOpcode2Count, "UDON_VM2_OPCODES is out of sync with Opcode2");
+#endif
 
 	auto place_args = [&](const US2Function& f, US2Frame& target_frame, const std::vector<UdonValue>& args_vec) -> bool
 	{
+		auto bind = [&](s32 slot, const UdonValue& v) -> bool
+		{
+			UdonValue* dst = resolve_ref(US2ValueRef(0, slot), target_frame);
+			if (!dst)
+				return false;
+			if (target_frame.env)
+				gc_write_barrier(target_frame.env, v);
+			*dst = v;
+			return true;
+		};
 		size_t total_params = !f.param_slots.empty() ? f.param_slots.size() : f.params.size();
 		size_t fixed_params = (f.variadic && total_params > 0) ? (total_params - 1) : total_params;
 		size_t to_bind = std::min(args_vec.size(), fixed_params);
@@ -736,67 +1293,108 @@ CodeLocation UdonInterpreter2::run(const std::string& function_name,
 			s32 slot = (!f.param_slots.empty() && i < f.param_slots.size()) ? f.param_slots[i] : static_cast<s32>(i);
 			if (slot < 0)
 				slot = static_cast<s32>(i);
-			size_t idx = target_frame.base + static_cast<size_t>(slot);
-			if (idx >= value_stack.size())
+			if (!bind(slot, args_vec[i]))
 				return false;
-			value_stack[idx] = args_vec[i];
-			if (target_frame.env && static_cast<size_t>(slot) < target_frame.env->slots.size())
-				target_frame.env->slots[static_cast<size_t>(slot)] = args_vec[i];
 		}
 		if (f.variadic || f.variadic_slot >= 0)
 		{
 			s32 var_slot = f.variadic_slot >= 0 ? f.variadic_slot : static_cast<s32>(fixed_params);
 			UdonValue vargs = make_array();
 			for (size_t i = fixed_params; i < args_vec.size(); ++i)
-				array_set(vargs, std::to_string(i - fixed_params), args_vec[i]);
-			size_t idx = target_frame.base + static_cast<size_t>(var_slot);
-			if (idx >= value_stack.size())
+				array_set_at(vargs, static_cast<s64>(i - fixed_params), args_vec[i]);
+			if (!bind(var_slot, vargs))
 				return false;
-			value_stack[idx] = vargs;
-			if (target_frame.env && static_cast<size_t>(var_slot) < target_frame.env->slots.size())
-				target_frame.env->slots[static_cast<size_t>(var_slot)] = vargs;
 		}
 		return true;
 	};
 
-	value_stack.clear();
-	call_stack.clear();
-	const US2Function* fn = &fit->second;
-	US2Frame frame{};
-	frame.base = 0;
-	frame.size = fn->frame_size;
-	frame.ip = 0;
-	frame.fn = fn;
-	frame.has_ret = false;
-	frame.env = host ? host->allocate_environment(frame.size, nullptr) : nullptr;
-	value_stack.resize(frame.base + frame.size, make_none());
-	call_stack.push_back(frame);
-	if (!place_args(*fn, call_stack.back(), args))
-		return fail("Argument placement failed");
+	// Each nested run also holds a dispatch loop on the C++ stack, which runs
+	// out long before max_call_depth when callbacks recurse through builtins.
+	if (nested_runs >= max_nested_runs)
+		return fail("Maximum nesting of " + std::to_string(max_nested_runs) + " callback runs exceeded");
+	struct NestedRunCount
+	{
+		size_t& runs;
+		explicit NestedRunCount(size_t& r) : runs(r) { ++runs; }
+		~NestedRunCount() { --runs; }
+	} nested_run_count(nested_runs);
+
+	// Stacks persist across runs; a nested run (host callbacks, imports, global
+	// init) stacks its frames on top and truncates back to its entry depth.
+	struct StackRestore
+	{
+		UdonInterpreter2* vm;
+		size_t frames;
+		US2StackMark values;
+		size_t floor;
+		~StackRestore()
+		{
+			vm->call_stack.resize(frames);
+			vm->value_stack.release(values);
+			vm->frame_floor = floor;
+		}
+	} stack_restore{ this, call_stack.size(), value_stack.mark(), frame_floor };
+	const size_t entry_frames = call_stack.size();
+	frame_floor = entry_frames;
 
-	HostRootPop root_guard(&value_stack);
-	UdonEnvironment* env_root = call_stack.empty() ? nullptr : call_stack.back().env;
-	struct EnvRootGuard
+	// The GC marks the registers and environments of every frame on a
+	// registered VM.
+	struct ActiveVmGuard
 	{
-		UdonEnvironment** env_ptr;
-		EnvRootGuard(UdonEnvironment** e) : env_ptr(e)
+		UdonInterpreter* host;
+		ActiveVmGuard(UdonInterpreter* h, const UdonInterpreter2* vm) : host(h)
 		{
-			if (g_udon_current)
-				g_udon_current->active_env_roots.push_back(env_ptr);
+			if (host)
+				host->active_vms.push_back(vm);
 		}
-		~EnvRootGuard()
+		~ActiveVmGuard()
 		{
-			if (g_udon_current)
-				g_udon_current->active_env_roots.pop_back();
+			if (host && !host->active_vms.empty())
+				host->active_vms.pop_back();
 		}
-	} env_guard(&env_root);
+	} vm_guard(host, this);
 
-	std::vector<UdonValue> call_args;
-	call_args.reserve(8);
+	// Only frames whose slots a closure can reach keep them in an environment.
+	auto make_env = [&](const US2Function& f, UdonEnvironment* outer_env) -> UdonEnvironment*
+	{
+		return (host && f.needs_env) ? host->allocate_environment(f.frame_size, outer_env) : nullptr;
+	};
+
+	// A frame gets a register window unless its slots live in an environment.
+	auto open_frame = [&](const US2Function& f, UdonEnvironment* outer_env) -> US2Frame
+	{
+		US2Frame frame{};
+		frame.size = f.frame_size;
+		frame.fn = &f;
+		frame.outer = outer_env;
+		frame.env = make_env(f, outer_env);
+		frame.stack_mark = value_stack.mark();
+		if (!frame.env)
+			frame.regs = value_stack.push(frame.size);
+		return frame;
+	};
+	auto pop_frame = [&]()
+	{
+		value_stack.release(call_stack.back().stack_mark);
+		call_stack.pop_back();
+	};
+	auto depth_error = [&]() -> CodeLocation
+	{
+		return fail("Maximum call depth of " + std::to_string(max_call_depth) + " exceeded");
+	};
+
+	if (call_stack.size() >= max_call_depth)
+		return depth_error();
+	call_stack.push_back(open_frame(*fn, outer));
+	if (!place_args(*fn, call_stack.back(), args))
+		return fail("Argument placement failed");
+
+	std::vector<UdonValue> call_args; // grows on the first CALL; leaf callbacks never allocate it
+	HostRootPop call_args_root(&call_args);
 
 	auto load_value = [&](US2Frame& current, const US2ValueRef& r, UdonValue& out) -> bool
 	{
-		UdonValue* slot = resolve_ref(*this, r, &current);
+		UdonValue* slot = resolve_ref(r, current);
 		if (!slot)
 			return false;
 		out = *slot;
@@ -805,114 +1403,130 @@ CodeLocation UdonInterpreter2::run(const std::string& function_name,
 
 	auto store_value = [&](US2Frame& current, const US2ValueRef& r, const UdonValue& v) -> bool
 	{
-		US2Frame* target_frame = frame_for_ref(*this, r, &current);
-		if (!target_frame)
-			return false;
-		UdonValue* slot = resolve_ref(*this, r, target_frame);
+		UdonValue* slot = resolve_ref(r, current);
 		if (!slot)
 			return false;
+		if (r.frame_depth != 0 || current.env)
+			gc_write_barrier(env_for_ref(current, r.frame_depth), v);
 		*slot = v;
-		if (target_frame->env && r.index >= 0 && static_cast<size_t>(r.index) < target_frame->env->slots.size())
-			target_frame->env->slots[static_cast<size_t>(r.index)] = v;
 		return true;
 	};
 
-	while (!call_stack.empty())
+	// Scalar results of quickened ops: straight into the register when the
+	// frame keeps its slots on the value stack.
+	auto store_register = [&](US2Frame& current, const US2ValueRef& r, UdonValue&& v)
+	{
+		if (r.frame_depth == 0 && !current.env && r.index >= 0 && static_cast<size_t>(r.index) < current.size)
+		{
+			current.regs[r.index] = std::move(v);
+			return;
+		}
+		store_value(current, r, v);
+	};
+
+	while (call_stack.size() > entry_frames)
 	{
-		env_root = call_stack.empty() ? nullptr : call_stack.back().env;
 		US2Frame& fr = call_stack.back();
+		sync_link(host);
 		if (!fr.fn || !fr.fn->code)
 			return fail("Invalid function frame");
 
 		if (fr.ip >= fr.fn->code->size())
 		{
 			US2ValueRef ret = fr.ret_dst; // capture before pop
-			call_stack.pop_back();
+			pop_frame();
 			UdonValue rv = make_none();
-			if (call_stack.empty())
+			if (call_stack.size() == entry_frames)
 			{
 				return_value = rv;
 				return err;
 			}
-			else
-			{
-				store_value(call_stack.back(), ret, rv);
-				size_t target_size = call_stack.back().base + call_stack.back().size;
-				if (value_stack.size() > target_size)
-					value_stack.resize(target_size);
-				continue;
-			}
+			store_value(call_stack.back(), ret, rv);
+			continue;
 		}
 
-		const US2Instruction& op = (*(fr.fn->code))[fr.ip];
-		if (host)
-		{
-			const size_t op_idx = static_cast<size_t>(op.opcode);
-			if (op_idx < host->stats.opcode2_counts.size())
-				host->stats.opcode2_counts[op_idx]++;
-		}
+		// Profiling is picked up whenever a frame is (re)entered, e.g. after the
+		// builtin call that enabled it.
+		const bool profile = host && host->stats.profile_opcodes2;
+#if UDON_VM2_COMPUTED_GOTO
+		const void* const* handlers = profile ? kCountingHandlers : kHandlers;
+		if (fr.fn->decoded_for != handlers)
+			decode_us2_code(*fr.fn, handlers);
+		const US2Instruction* const code_base = fr.fn->code->data();
+		const UdonValue* const konst = fr.fn->tables ? fr.fn->tables->constants.data() : nullptr;
+		const US2Instruction* op = &code_base[fr.ip];
+		goto* op->handler;
+		UDON_VM2_OPCODES(VM2_COUNT_STUB)
+#else
+		const US2Instruction* op = &(*(fr.fn->code))[fr.ip];
+		const UdonValue* const konst = fr.fn->tables ? fr.fn->tables->constants.data() : nullptr;
+		if (profile)
+			host->stats.opcode2_counts[static_cast<size_t>(op->opcode)]++;
+#endif
 
-		switch (op.opcode)
+		switch (op->opcode)
 		{
-			case Opcode2::NOP:
+			VM2_OP(NOP):
 				fr.ip++;
-				break;
-			case Opcode2::LOADK:
+				VM2_NEXT();
+			VM2_OP(LOADK):
 			{
-				store_value(fr, op.dst, op.literal);
+				store_value(fr, op->dst, konst[op->k]);
 				fr.ip++;
-				break;
 			}
-			case Opcode2::MOVE:
+			VM2_NEXT();
+			VM2_OP(MOVE):
 			{
 				UdonValue tmp{};
-				if (!load_value(fr, op.a, tmp))
+				if (!load_value(fr, op->a, tmp))
 					return fail("Invalid MOVE source");
-				store_value(fr, op.dst, tmp);
+				store_value(fr, op->dst, tmp);
 				fr.ip++;
-				break;
 			}
-			case Opcode2::POP:
+			VM2_NEXT();
+			VM2_OP(POP):
 			{
 				fr.ip++;
-				break;
 			}
-			case Opcode2::LOAD_GLOBAL:
+			VM2_NEXT();
+			VM2_OP(LOAD_GLOBAL):
 			{
 				if (!host)
 					return fail("Host interpreter missing for global load");
-				std::string name = op.has_literal ? op.literal.string_value : "";
-				UdonValue v;
-				if (!host->get_global_value(name, v))
-					v = make_none();
-				store_value(fr, op.dst, v);
+				const size_t slot = static_cast<size_t>(op->b.index);
+				if (slot < host->global_slots.size())
+					store_value(fr, op->dst, host->global_slots[slot]);
+				else
+					store_value(fr, op->dst, make_none());
 				fr.ip++;
-				break;
 			}
-			case Opcode2::STORE_GLOBAL:
+			VM2_NEXT();
+			VM2_OP(STORE_GLOBAL):
 			{
 				if (!host)
 					return fail("Host interpreter missing for global store");
-				std::string name = op.has_literal ? op.literal.string_value : "";
 				UdonValue v{};
-				if (!load_value(fr, op.a, v))
+				if (!load_value(fr, op->a, v))
 					return fail("Invalid STORE_GLOBAL source");
-				host->set_global_value(name, v);
+				const size_t slot = static_cast<size_t>(op->b.index);
+				if (slot >= host->global_slots.size())
+					host->global_slots.resize(slot + 1, make_none());
+				host->global_slots[slot] = std::move(v);
 				fr.ip++;
-				break;
 			}
-			case Opcode2::ADD:
-			case Opcode2::SUB:
-			case Opcode2::CONCAT:
-			case Opcode2::MUL:
-			case Opcode2::DIV:
-			case Opcode2::MOD:
+			VM2_NEXT();
+			VM2_OP(ADD):
+			VM2_OP(SUB):
+			VM2_OP(CONCAT):
+			VM2_OP(MUL):
+			VM2_OP(DIV):
+			VM2_OP(MOD):
 			{
 				UdonValue lhs{}, rhs{}, result{};
-				if (!load_value(fr, op.a, lhs) || !load_value(fr, op.b, rhs))
+				if (!load_value(fr, op->a, lhs) || !load_value(fr, op->b, rhs))
 					return fail("Invalid binary operands");
 				bool ok = false;
-				switch (op.opcode)
+				switch (op->opcode)
 				{
 					case Opcode2::CONCAT:
 						result = make_string(value_to_string(lhs) + value_to_string(rhs));
@@ -938,14 +1552,16 @@ CodeLocation UdonInterpreter2::run(const std::string& function_name,
 				}
 				if (!ok)
 					return fail("Arithmetic error");
-				store_value(fr, op.dst, result);
+				store_value(fr, op->dst, result);
+				if (quicken)
+					maybe_quicken(*fr.fn, *op, lhs, rhs);
 				fr.ip++;
-				break;
 			}
-			case Opcode2::NEGATE:
+			VM2_NEXT();
+			VM2_OP(NEGATE):
 			{
 				UdonValue src{};
-				if (!load_value(fr, op.a, src))
+				if (!load_value(fr, op->a, src))
 					return fail("Invalid NEGATE source");
 				if (!is_numeric(src))
 					return fail("Cannot negate value");
@@ -953,40 +1569,40 @@ CodeLocation UdonInterpreter2::run(const std::string& function_name,
 					src.int_value = -src.int_value;
 				else
 					src.float_value = -src.float_value;
-				store_value(fr, op.dst, src);
+				store_value(fr, op->dst, src);
 				fr.ip++;
-				break;
 			}
-			case Opcode2::TO_BOOL:
+			VM2_NEXT();
+			VM2_OP(TO_BOOL):
 			{
 				UdonValue src{};
-				if (!load_value(fr, op.a, src))
+				if (!load_value(fr, op->a, src))
 					return fail("Invalid TO_BOOL source");
-				store_value(fr, op.dst, make_bool(bool_value(src)));
+				store_value(fr, op->dst, make_bool(bool_value(src)));
 				fr.ip++;
-				break;
 			}
-			case Opcode2::LOGICAL_NOT:
+			VM2_NEXT();
+			VM2_OP(LOGICAL_NOT):
 			{
 				UdonValue src{};
-				if (!load_value(fr, op.a, src))
+				if (!load_value(fr, op->a, src))
 					return fail("Invalid NOT source");
-				store_value(fr, op.dst, make_bool(!bool_value(src)));
+				store_value(fr, op->dst, make_bool(!bool_value(src)));
 				fr.ip++;
-				break;
 			}
-			case Opcode2::EQ:
-			case Opcode2::NEQ:
-			case Opcode2::LT:
-			case Opcode2::LTE:
-			case Opcode2::GT:
-			case Opcode2::GTE:
+			VM2_NEXT();
+			VM2_OP(EQ):
+			VM2_OP(NEQ):
+			VM2_OP(LT):
+			VM2_OP(LTE):
+			VM2_OP(GT):
+			VM2_OP(GTE):
 			{
 				UdonValue lhs{}, rhs{}, result{};
-				if (!load_value(fr, op.a, lhs) || !load_value(fr, op.b, rhs))
+				if (!load_value(fr, op->a, lhs) || !load_value(fr, op->b, rhs))
 					return fail("Invalid compare operands");
 				Opcode cmp = Opcode::EQ;
-				switch (op.opcode)
+				switch (op->opcode)
 				{
 					case Opcode2::EQ:
 						cmp = Opcode::EQ;
@@ -1021,59 +1637,142 @@ CodeLocation UdonInterpreter2::run(const std::string& function_name,
 					if (!compare_values(lhs, rhs, cmp, result))
 						return fail("Comparison failed");
 				}
-				store_value(fr, op.dst, result);
+				store_value(fr, op->dst, result);
+				if (quicken)
+					maybe_quicken(*fr.fn, *op, lhs, rhs);
 				fr.ip++;
-				break;
 			}
-			case Opcode2::GET_PROP:
+			VM2_NEXT();
+			// A quickened handler whose operands no longer match turns the
+			// instruction back into its generic form and dispatches it again.
+#define VM2_QUICK_BINARY(name, type_tag, expr)                                                          \
+	VM2_OP(name):                                                                                       \
+	{                                                                                                   \
+		const UdonValue* lhs = resolve_ref(op->a, fr);                                           \
+		const UdonValue* rhs = resolve_ref(op->b, fr);                                           \
+		if (!lhs || !rhs || lhs->type != UdonValue::Type::type_tag || rhs->type != UdonValue::Type::type_tag) \
+		{                                                                                               \
+			dequicken(*fr.fn, *op);                                                                     \
+			VM2_NEXT();                                                                                 \
+		}                                                                                               \
+		store_register(fr, op->dst, expr);                                                              \
+		fr.ip++;                                                                                        \
+	}                                                                                                   \
+	VM2_NEXT();
+			VM2_QUICK_BINARY(ADD_INT, Int, make_int(lhs->int_value + rhs->int_value))
+			VM2_QUICK_BINARY(ADD_FLOAT, Float, make_float(lhs->float_value + rhs->float_value))
+			VM2_QUICK_BINARY(SUB_INT, Int, make_int(lhs->int_value - rhs->int_value))
+			VM2_QUICK_BINARY(SUB_FLOAT, Float, make_float(lhs->float_value - rhs->float_value))
+			VM2_QUICK_BINARY(MUL_INT, Int, make_int(lhs->int_value * rhs->int_value))
+			VM2_QUICK_BINARY(MUL_FLOAT, Float, make_float(lhs->float_value * rhs->float_value))
+			VM2_QUICK_BINARY(EQ_INT, Int, make_bool(lhs->int_value == rhs->int_value))
+			VM2_QUICK_BINARY(NEQ_INT, Int, make_bool(lhs->int_value != rhs->int_value))
+			VM2_QUICK_BINARY(LT_INT, Int, make_bool(lhs->int_value < rhs->int_value))
+			VM2_QUICK_BINARY(LT_FLOAT, Float, make_bool(lhs->float_value < rhs->float_value))
+			VM2_QUICK_BINARY(LTE_INT, Int, make_bool(lhs->int_value <= rhs->int_value))
+			VM2_QUICK_BINARY(LTE_FLOAT, Float, make_bool(lhs->float_value <= rhs->float_value))
+			VM2_QUICK_BINARY(GT_INT, Int, make_bool(lhs->int_value > rhs->int_value))
+			VM2_QUICK_BINARY(GT_FLOAT, Float, make_bool(lhs->float_value > rhs->float_value))
+			VM2_QUICK_BINARY(GTE_INT, Int, make_bool(lhs->int_value >= rhs->int_value))
+			VM2_QUICK_BINARY(GTE_FLOAT, Float, make_bool(lhs->float_value >= rhs->float_value))
+#undef VM2_QUICK_BINARY
+			VM2_OP(GET_PROP):
 			{
 				UdonValue obj{}, res{};
-				if (!load_value(fr, op.a, obj))
+				if (!load_value(fr, op->a, obj))
 					return fail("Invalid GET_PROP object");
-				bool ok = false;
-				if (op.has_literal)
-					ok = get_property_value(obj, op.literal.string_value, res);
+				if (op->has_literal)
+				{
+					const US2PropSite& site = fr.fn->tables->prop_sites[static_cast<size_t>(op->b.index)];
+					const UdonValue::ManagedArray* arr = obj.type == UdonValue::Type::Array ? obj.array_map : nullptr;
+					if (arr && arr->shape && arr->shape->id == site.shape_id)
+						res = arr->entries[site.slot].value;
+					else
+						get_property_cached(obj, konst[op->k], site, res);
+				}
 				else
 				{
 					UdonValue idx{};
-					if (!load_value(fr, op.b, idx))
+					if (!load_value(fr, op->b, idx))
 						return fail("Invalid GET_PROP index");
-					ok = get_index_value(obj, idx, res);
+					if (!get_index_value(obj, idx, res))
+						return fail("Property access failed");
 				}
-				if (!ok)
-					return fail("Property access failed");
-				store_value(fr, op.dst, res);
+				store_value(fr, op->dst, res);
 				fr.ip++;
-				break;
 			}
-			case Opcode2::STORE_PROP:
+			VM2_NEXT();
+			VM2_OP(STORE_PROP):
 			{
-				UdonValue* obj_ref = resolve_ref(*this, op.dst, &fr);
+				UdonValue* obj_ref = resolve_ref(op->dst, fr);
 				if (!obj_ref)
 					return fail("Invalid STORE_PROP object");
 				UdonValue value{};
-				if (!load_value(fr, op.a, value))
+				if (!load_value(fr, op->a, value))
 					return fail("Invalid STORE_PROP value");
-				if (op.has_literal)
-					array_set(*obj_ref, op.literal.string_value, value);
+				if (op->has_literal)
+				{
+					const US2PropSite& site = fr.fn->tables->prop_sites[static_cast<size_t>(op->b.index)];
+					UdonValue::ManagedArray* arr = obj_ref->type == UdonValue::Type::Array ? obj_ref->array_map : nullptr;
+					if (arr && arr->shape && arr->shape->id == site.shape_id)
+					{
+						gc_write_barrier(arr, value);
+						arr->entries[site.slot].value = value;
+					}
+					else
+						set_property_cached(*obj_ref, konst[op->k], value, site);
+				}
 				else
 				{
 					UdonValue idx{};
-					if (!load_value(fr, op.b, idx))
+					if (!load_value(fr, op->b, idx))
 						return fail("Invalid STORE_PROP index");
-					array_set(*obj_ref, key_from_value(idx), value);
+					if (idx.type == UdonValue::Type::Int)
+						array_set_at(*obj_ref, idx.int_value, value);
+					else if (idx.type == UdonValue::Type::String || array_is_table(*obj_ref))
+						array_set(*obj_ref, idx, value); // keeps an interned key's string, or a set/map key's type
+					else
+						array_set(*obj_ref, key_from_value(idx), value);
 				}
+				if (op->dst.frame_depth != 0 || fr.env) // a non-array target is replaced in place
+					gc_write_barrier(env_for_ref(fr, op->dst.frame_depth), *obj_ref);
 				fr.ip++;
-				break;
 			}
-			case Opcode2::MAKE_CLOSURE:
+			VM2_NEXT();
+			VM2_OP(ITER_NEXT):
+			{
+				UdonValue* coll = resolve_ref(op->a, fr);
+				UdonValue* cursor = resolve_ref(op->b, fr);
+				if (!coll || !cursor)
+					return fail("Invalid ITER_NEXT operands");
+				store_value(fr, op->dst, make_int(iter_next(*coll, cursor->int_value)));
+				fr.ip++;
+			}
+			VM2_NEXT();
+			VM2_OP(ITER_KEY):
+			VM2_OP(ITER_VALUE):
+			{
+				UdonValue* coll = resolve_ref(op->a, fr);
+				UdonValue* cursor = resolve_ref(op->b, fr);
+				if (!coll || !cursor)
+					return fail("Invalid foreach operands");
+				UdonValue item;
+				if (op->opcode == Opcode2::ITER_KEY)
+					iter_key(*coll, cursor->int_value, item);
+				else
+					iter_value(*coll, cursor->int_value, item);
+				store_value(fr, op->dst, item);
+				fr.ip++;
+			}
+			VM2_NEXT();
+			VM2_OP(MAKE_CLOSURE):
 			{
 				UdonValue v{};
 				v.type = UdonValue::Type::Function;
 				v.function = host ? host->allocate_function() : nullptr;
 				if (v.function)
 				{
-					v.function->function_name = op.has_literal ? op.literal.string_value : "";
+					v.function->function_name = op->has_literal ? konst[op->k].string_value() : "";
 					v.function->captured_env = fr.env;
 					if (host)
 					{
@@ -1096,38 +1795,70 @@ CodeLocation UdonInterpreter2::run(const std::string& function_name,
 							v.function->variadic_param = var_it->second;
 					}
 				}
-				store_value(fr, op.dst, v);
+				store_value(fr, op->dst, v);
 				fr.ip++;
-				break;
 			}
-			case Opcode2::JUMP:
+			VM2_NEXT();
+			VM2_OP(JUMP):
 			{
-				if (op.jump_target < 0 || static_cast<size_t>(op.jump_target) > fr.fn->code->size())
+				if (op->jump_target < 0 || static_cast<size_t>(op->jump_target) >= fr.fn->code->size())
 					return fail("Invalid jump target");
-				fr.ip = static_cast<size_t>(op.jump_target);
-				break;
+				if (static_cast<size_t>(op->jump_target) <= fr.ip && host && host->gc_due())
+					host->collect_at_safepoint();
+				fr.ip = static_cast<size_t>(op->jump_target);
 			}
-			case Opcode2::JUMP_IF_FALSE:
+			VM2_NEXT();
+			VM2_OP(JUMP_IF_FALSE):
 			{
 				UdonValue cond{};
-				if (!load_value(fr, op.a, cond))
+				if (!load_value(fr, op->a, cond))
 					return fail("Invalid jump condition");
 				if (!bool_value(cond))
 				{
-					if (op.jump_target < 0 || static_cast<size_t>(op.jump_target) > fr.fn->code->size())
+					if (op->jump_target < 0 || static_cast<size_t>(op->jump_target) >= fr.fn->code->size())
 						return fail("Invalid jump target");
-					fr.ip = static_cast<size_t>(op.jump_target);
+					if (static_cast<size_t>(op->jump_target) <= fr.ip && host && host->gc_due())
+						host->collect_at_safepoint();
+					fr.ip = static_cast<size_t>(op->jump_target);
 				}
 				else
 				{
 					fr.ip++;
 				}
-				break;
 			}
-			case Opcode2::CALL:
+			VM2_NEXT();
+			VM2_OP(CALL):
 			{
-				s32 argc = op.has_literal ? static_cast<s32>(op.literal.int_value) : 0;
-				US2ValueRef args_base = op.callee_name.empty() ? op.b : op.a;
+				if (host && host->gc_due())
+					host->collect_at_safepoint();
+				const US2CallSite& site = fr.fn->tables->call_sites[op->k];
+				if (site.link_epoch != link_epoch)
+					link_call(*this, host, site);
+				const s32 argc = site.argc;
+				US2ValueRef args_base = site.call_kind == US2CallKind::Dynamic ? op->b : op->a;
+				// Span builtins read the argument registers in place. The
+				// result goes through rv: dst is usually the first argument.
+				if (site.callee_span && !kDebugCalls)
+				{
+					const UdonValue* args = nullptr;
+					if (argc > 0)
+					{
+						args = resolve_ref(args_base, fr);
+						if (!args || !resolve_ref(US2ValueRef{ args_base.frame_depth, args_base.index + argc - 1 }, fr))
+							return fail("Invalid CALL argument");
+					}
+					UdonValue rv{};
+					CodeLocation inner{};
+					{
+						NativeCallScope native(host);
+						if (!site.callee_span(host, UdonArgs(args, static_cast<size_t>(argc)), rv, inner))
+							return inner.has_error ? inner : fail("Builtin call failed");
+					}
+					US2Frame& cur = call_stack.back(); // the builtin may have re-entered run()
+					store_value(cur, op->dst, rv);
+					cur.ip++;
+					break;
+				}
 				call_args.clear();
 				call_args.reserve(static_cast<size_t>(argc));
 				auto load_args = [&](const US2ValueRef& base, std::vector<UdonValue>& out) -> bool
@@ -1145,34 +1876,18 @@ CodeLocation UdonInterpreter2::run(const std::string& function_name,
 				};
 				if (!load_args(args_base, call_args))
 					return fail("Invalid CALL argument");
-				if (op.callee_name == "print" && argc >= 2 && args_base.index > 0 && call_args.size() >= 1 && call_args[0].type != UdonValue::Type::String)
-				{
-					US2ValueRef shifted = args_base;
-					shifted.index -= 1;
-					UdonValue prev{};
-					if (load_value(fr, shifted, prev) && prev.type == UdonValue::Type::String)
-					{
-						std::vector<UdonValue> shifted_args;
-						if (load_args(shifted, shifted_args))
-						{
-							args_base = shifted;
-							call_args.swap(shifted_args);
-						}
-					}
-				}
-
 				if (kDebugCalls)
 				{
 					std::ostringstream dbg;
 					dbg << "[VM2 CALL] callee=";
-					if (!op.callee_name.empty())
+					if (!site.callee_name.empty())
 					{
-						dbg << op.callee_name;
+						dbg << site.callee_name;
 					}
 					else
 					{
 						UdonValue callable_dbg{};
-						if (load_value(fr, op.a, callable_dbg))
+						if (load_value(fr, op->a, callable_dbg))
 							dbg << value_to_string(callable_dbg);
 						else
 							dbg << "<callable load error>";
@@ -1184,7 +1899,7 @@ CodeLocation UdonInterpreter2::run(const std::string& function_name,
 							dbg << ", ";
 						dbg << value_to_string(call_args[i]);
 					}
-					dbg << "] dst=" << op.dst.frame_depth << ":" << op.dst.index;
+					dbg << "] dst=" << op->dst.frame_depth << ":" << op->dst.index;
 					dbg << " slots=";
 					for (s32 i = 0; i < argc; ++i)
 					{
@@ -1202,120 +1917,150 @@ CodeLocation UdonInterpreter2::run(const std::string& function_name,
 
 				auto finish_return = [&](const UdonValue& rv)
 				{
-					store_value(fr, op.dst, rv);
-					fr.ip++;
+					// host calls may re-enter run() and grow call_stack, so fr can be stale here
+					US2Frame& cur = call_stack.back();
+					store_value(cur, op->dst, rv);
+					cur.ip++;
 				};
 
-				if (!op.callee_name.empty())
+				// Script callees, named or closures, run in a new frame of this
+				// loop rather than a nested interpreter. A tail call takes over
+				// the caller's frame, so tail recursion runs in constant space.
+				auto enter = [&](const US2Function* callee, UdonEnvironment* callee_outer) -> CodeLocation
 				{
-					auto fn_it = functions.find(op.callee_name);
-					if (fn_it != functions.end())
-					{
+					const bool has_ret = site.tail ? fr.has_ret : true;
+					const US2ValueRef ret_dst = site.tail ? fr.ret_dst : op->dst;
+					if (site.tail)
+						pop_frame(); // the arguments are already copied out
+					else if (call_stack.size() >= max_call_depth)
+						return depth_error();
+					else
 						fr.ip++;
-						US2Frame child{};
-						child.base = value_stack.size();
-						child.size = fn_it->second.frame_size;
-						child.ip = 0;
-						child.fn = &fn_it->second;
-						child.has_ret = true;
-						child.ret_dst = op.dst;
-						child.env = host ? host->allocate_environment(child.size, fr.env) : nullptr;
-						value_stack.resize(child.base + child.size, make_none());
-						if (!place_args(*child.fn, child, call_args))
-							return fail("Argument placement failed");
-						if (kDebugCalls)
+					US2Frame child = open_frame(*callee, callee_outer);
+					child.has_ret = has_ret;
+					child.ret_dst = ret_dst;
+					if (!place_args(*child.fn, child, call_args))
+						return fail("Argument placement failed");
+					if (kDebugCalls)
+					{
+						std::ostringstream dbg;
+						dbg << "[VM2 ENTER] fn=" << child.fn->name
+							<< " size=" << child.size << (site.tail ? " tail" : "")
+							<< " params=" << child.fn->params.size() << " slots=[";
+						for (size_t i = 0; i < child.fn->param_slots.size(); ++i)
 						{
-							std::ostringstream dbg;
-							dbg << "[VM2 ENTER] fn=" << child.fn->name
-								<< " base=" << child.base << " size=" << child.size
-								<< " params=" << child.fn->params.size() << " slots=[";
-							for (size_t i = 0; i < child.fn->param_slots.size(); ++i)
-							{
-								if (i)
-									dbg << ",";
-								dbg << child.fn->param_slots[i];
-							}
-							dbg << "] var_slot=" << child.fn->variadic_slot;
-							dbg << " args=[";
-							for (size_t i = 0; i < call_args.size(); ++i)
-							{
-								if (i)
-									dbg << ",";
-								dbg << value_to_string(call_args[i]);
-							}
-							dbg << "]";
-							std::cerr << dbg.str() << std::endl;
+							if (i)
+								dbg << ",";
+							dbg << child.fn->param_slots[i];
 						}
-						call_stack.push_back(child);
-						continue;
+						dbg << "] var_slot=" << child.fn->variadic_slot;
+						dbg << " args=[";
+						for (size_t i = 0; i < call_args.size(); ++i)
+						{
+							if (i)
+								dbg << ",";
+							dbg << value_to_string(call_args[i]);
+						}
+						dbg << "]";
+						std::cerr << dbg.str() << std::endl;
+					}
+					call_stack.push_back(child);
+					return err;
+				};
+
+				if (site.call_kind == US2CallKind::Script)
+				{
+					CodeLocation entered = enter(site.callee_fn, nullptr);
+					if (entered.has_error)
+						return entered;
+					continue;
+				}
+
+				if (site.call_kind == US2CallKind::Dynamic)
+				{
+					// The callable stays reachable through its register for the
+					// whole call. A function object whose code this site has
+					// called before skips the lookups.
+					UdonValue callable{};
+					if (!load_value(fr, op->a, callable))
+						return fail("Invalid callable value");
+					UdonValue::ManagedFunction* target = callable.type == UdonValue::Type::Function ? callable.function : nullptr;
+					if (target && !target->native_handler && target->code_ptr)
+					{
+						const void* code = target->code_ptr.get();
+						if (code != site.ic_code)
+						{
+							site.ic_code = code;
+							site.ic_fn = us2_function_for(function_table(), target);
+						}
+						if (site.ic_fn)
+						{
+							CodeLocation entered = enter(site.ic_fn, target->captured_env);
+							if (entered.has_error)
+								return entered;
+							continue;
+						}
+					}
+					if (host)
+					{
+						UdonValue rv{};
+						CodeLocation inner = host->invoke_function(callable, call_args, rv);
+						if (inner.has_error)
+							return inner;
+						finish_return(rv);
+						break;
 					}
 				}
 
 				if (host)
 				{
-					if (!op.callee_name.empty())
+					if (site.call_kind == US2CallKind::Builtin)
 					{
-						auto bit = host->builtins.find(op.callee_name);
-						if (bit != host->builtins.end())
+						UdonValue rv{};
+						CodeLocation inner{};
 						{
-							UdonValue rv{};
-							CodeLocation inner{};
-							if (!bit->second.function(host, call_args, rv, inner))
+							NativeCallScope native(host);
+							if (!(*site.callee_builtin)(host, call_args, rv, inner))
 								return inner.has_error ? inner : fail("Builtin call failed");
-							finish_return(rv);
-							break;
 						}
-
+						finish_return(rv);
+						break;
+					}
+					if (site.call_kind == US2CallKind::Host)
+					{
 						UdonValue rv{};
-						CodeLocation inner = host->run(op.callee_name, call_args, rv);
+						CodeLocation inner = host->run(site.callee_name, call_args, rv);
 						if (inner.has_error)
 							return inner;
 						finish_return(rv);
 						break;
 					}
-
-					UdonValue callable{};
-					if (!load_value(fr, op.a, callable))
-						return fail("Invalid callable value");
-					UdonValue rv{};
-					CodeLocation inner = host->invoke_function(callable, call_args, rv);
-					if (inner.has_error)
-						return inner;
-					finish_return(rv);
-					break;
 				}
 
-				return fail(op.callee_name.empty() ? "Dynamic call requires host interpreter" : "Function '" + op.callee_name + "' not found");
+				return fail(site.callee_name.empty() ? "Dynamic call requires host interpreter" : "Function '" + site.callee_name + "' not found");
 			}
-			case Opcode2::RETURN:
+			VM2_OP(RETURN):
 			{
 				UdonValue rv{};
-				load_value(fr, op.a, rv);
+				load_value(fr, op->a, rv);
 				US2ValueRef ret = fr.ret_dst; // capture before pop
-				const std::string fn_name = fr.fn ? fr.fn->name : std::string("<null>");
-				call_stack.pop_back();
 				if (kDebugCalls)
 				{
 					std::ostringstream dbg;
 					dbg << "[VM2 RETURN] fn="
-						<< fn_name << " rv=" << value_to_string(rv);
+						<< (fr.fn ? fr.fn->name : std::string("<null>")) << " rv=" << value_to_string(rv);
 					std::cerr << dbg.str() << std::endl;
 				}
-				if (call_stack.empty())
+				pop_frame();
+				if (call_stack.size() == entry_frames)
 				{
 					return_value = rv;
 					return err;
 				}
-				else
-				{
-					store_value(call_stack.back(), ret, rv);
-					size_t target_size = call_stack.back().base + call_stack.back().size;
-					if (value_stack.size() > target_size)
-						value_stack.resize(target_size);
-				}
+				store_value(call_stack.back(), ret, rv);
 				break;
 			}
-			case Opcode2::HALT:
+			VM2_OP(HALT):
 				return err;
 		}
 	}
@@ -1323,24 +2068,29 @@ CodeLocation UdonInterpreter2::run(const std::string& function_name,
 	return err;
 }
 
+#if UDON_VM2_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+#undef VM2_OP
+#undef VM2_NEXT
+
 bool UdonInterpreter2::load_from_host(UdonInterpreter* host_interp, CodeLocation& err)
 {
 	err.has_error = false;
 	if (!host_interp)
 		return true;
-	for (const auto& kv : host_interp->functions_v2)
-	{
-		const std::string& name = kv.first;
-		register_function(name, kv.second);
-	}
+	host_functions = &host_interp->functions_v2;
 	return true;
 }
 
 std::string dump_us2_function(const US2Function& fn)
 {
 	std::ostringstream ss;
-	ss << "function " << fn.name << "(frame_size=" << fn.frame_size << ")\n";
-	if (fn.code)
+	ss << "function " << fn.name << "(frame_size=" << fn.frame_size;
+	if (fn.code && fn.unoptimized_size)
+		ss << ", instructions=" << fn.code->size() << " of " << fn.unoptimized_size;
+	ss << ")\n";
+	if (fn.code && fn.tables)
 	{
 		for (size_t i = 0; i < fn.code->size(); ++i)
 		{
@@ -1349,10 +2099,17 @@ std::string dump_us2_function(const US2Function& fn)
 			   << " dst=" << op.dst.frame_depth << ":" << op.dst.index
 			   << " a=" << op.a.frame_depth << ":" << op.a.index
 			   << " b=" << op.b.frame_depth << ":" << op.b.index;
-			if (op.has_literal)
-				ss << " lit=" << value_to_string(op.literal);
-			if (!op.callee_name.empty())
-				ss << " callee=" << op.callee_name;
+			if (op.has_literal && op.k < fn.tables->constants.size())
+				ss << " lit=" << value_to_string(fn.tables->constants[op.k]);
+			if (op.opcode == Opcode2::CALL && op.k < fn.tables->call_sites.size())
+			{
+				const US2CallSite& site = fn.tables->call_sites[op.k];
+				ss << " argc=" << site.argc;
+				if (!site.callee_name.empty())
+					ss << " callee=" << site.callee_name;
+				if (site.tail)
+					ss << " tail";
+			}
 			if (op.jump_target >= 0)
 				ss << " jmp=" << op.jump_target;
 			ss << "\n";
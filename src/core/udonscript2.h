@@ -5,22 +5,40 @@
 #include <memory>
 #include <unordered_map>
 
+// Direct-threaded dispatch (GCC/Clang labels-as-values); the switch loop is
+// the fallback everywhere else.
+#ifndef UDON_VM2_COMPUTED_GOTO
+#if defined(__GNUC__)
+#define UDON_VM2_COMPUTED_GOTO 1
+#else
+#define UDON_VM2_COMPUTED_GOTO 0
+#endif
+#endif
+
 struct UdonInterpreter; // forward to allow reuse of builtins/invoke
 
+// Packed into 32 bits: compile_to_us2 rejects a function that reaches a frame
+// more than kUS2MaxFrameDepth levels out or needs kUS2MaxSlots slots.
 struct US2ValueRef
 {
-	s32 frame_depth = 0;
-	s32 index = 0;
+	s32 frame_depth : 8;
+	s32 index : 24;
+
+	US2ValueRef() : frame_depth(0), index(0) {}
+	US2ValueRef(s32 depth, s32 slot) : frame_depth(depth), index(slot) {}
 };
 
-enum class Opcode2
+constexpr s32 kUS2MaxSlots = (1 << 23) - 1;
+constexpr s32 kUS2MaxFrameDepth = 127;
+
+enum class Opcode2 : u8
 {
 	NOP,
 	MOVE, // dst = a
-	LOADK, // dst = literal
+	LOADK, // dst = constants[k]
 	POP,
-	LOAD_GLOBAL,
-	STORE_GLOBAL,
+	LOAD_GLOBAL, // dst = host global slot b.index (constants[k] keeps the name)
+	STORE_GLOBAL, // host global slot b.index = a
 	ADD,
 	SUB,
 	CONCAT,
@@ -30,8 +48,11 @@ enum class Opcode2
 	NEGATE,
 	TO_BOOL,
 	LOGICAL_NOT,
-	GET_PROP,
-	STORE_PROP,
+	GET_PROP, // dst = a[constants[k]] through prop_sites[b.index], or dst = a[b]
+	STORE_PROP, // dst[constants[k]] = a through prop_sites[b.index], or dst[b] = a
+	ITER_NEXT, // dst = next foreach cursor of a after cursor b (0 when done)
+	ITER_KEY, // dst = key at cursor b of a
+	ITER_VALUE, // dst = value at cursor b of a
 	MAKE_CLOSURE,
 	EQ,
 	NEQ,
@@ -41,27 +62,99 @@ enum class Opcode2
 	GTE,
 	JUMP, // jump_target
 	JUMP_IF_FALSE,
-	CALL, // a=function ref or named, b = arg count (index in literal.int_value), dst receives result
+	CALL, // call_sites[k]; named: args from a, dynamic: callee a, args from b; dst receives result
 	RETURN,
+	// Quickened forms: never emitted by compile_to_us2, the VM rewrites a
+	// generic ADD/SUB/MUL/compare into one of these once it has seen its
+	// operand types and rewrites it back when they change.
+	ADD_INT,
+	ADD_FLOAT,
+	SUB_INT,
+	SUB_FLOAT,
+	MUL_INT,
+	MUL_FLOAT,
+	EQ_INT,
+	NEQ_INT,
+	LT_INT,
+	LT_FLOAT,
+	LTE_INT,
+	LTE_FLOAT,
+	GT_INT,
+	GT_FLOAT,
+	GTE_INT,
+	GTE_FLOAT,
 	HALT,
 };
 
 constexpr size_t kOpcode2Count = static_cast<size_t>(Opcode2::HALT) + 1;
 
+// What a CALL instruction was bound to the last time it ran.
+enum class US2CallKind : u8
+{
+	Unlinked,
+	Script, // callee_fn
+	Builtin, // callee_span when it has one, otherwise callee_builtin
+	Host, // named, but neither: goes through UdonInterpreter::run
+	Dynamic, // callee in register a; ic_code caches the last script callee
+};
+
+// Per-CALL side data: the callee and the link cache, resolved on first
+// execution and trusted while link_epoch matches the running VM's (see
+// UdonInterpreter2::sync_link).
+struct US2CallSite
+{
+	std::string callee_name; // empty for dynamic calls
+	s32 argc = 0;
+	bool tail = false; // directly followed by a RETURN of its result (see us2_mark_tail_calls)
+	mutable u64 link_epoch = 0;
+	mutable US2CallKind call_kind = US2CallKind::Unlinked;
+	mutable const US2Function* callee_fn = nullptr;
+	mutable const UdonBuiltinFunction* callee_builtin = nullptr;
+	mutable UdonSpanBuiltinFunction callee_span = nullptr; // reads its arguments straight from the registers
+	mutable const void* ic_code = nullptr; // legacy code of the last script function called dynamically
+	mutable const US2Function* ic_fn = nullptr; // its translation, when it has one
+};
+
+// Inline cache of a GET_PROP/STORE_PROP with a literal name: the shape of the
+// object it last found the name on, and the name's position in that shape.
+struct US2PropSite
+{
+	mutable u64 shape_id = 0; // 0 matches nothing
+	mutable u32 slot = 0;
+};
+
+struct US2SourcePos
+{
+	u32 line = 0;
+	u32 column = 0;
+};
+
+// Side tables indexed from US2Instruction::k and by instruction position.
+struct US2Tables
+{
+	std::vector<UdonValue> constants;
+	std::vector<US2CallSite> call_sites;
+	std::vector<US2PropSite> prop_sites; // indexed by b.index of literal GET_PROP/STORE_PROP
+	std::vector<US2SourcePos> positions; // per instruction, for error locations
+};
+
+// Hot part of an instruction only; constants, call sites and source
+// positions live in the owning function's US2Tables.
 struct US2Instruction
 {
-	Opcode2 opcode = Opcode2::NOP;
+	const void* handler = nullptr; // pre-decoded dispatch target (computed-goto builds)
 	US2ValueRef dst{};
 	US2ValueRef a{};
 	US2ValueRef b{};
 	s32 jump_target = -1;
-	bool has_literal = false;
-	UdonValue literal{};
-	std::string callee_name; // optional for CALL
-	u32 line = 0;
-	u32 column = 0;
+	u32 k = 0; // constants index, or call_sites index for CALL
+	Opcode2 opcode = Opcode2::NOP;
+	bool has_literal = false; // constants[k] is an operand (property name, global name, LOADK value)
+	mutable u8 dequickens = 0; // times a quickened form fell back; past a limit the site stays generic
 };
 
+static_assert(sizeof(US2Instruction) <= 32, "US2Instruction should stay within half a cache line");
+
 using US2Code = std::vector<US2Instruction>;
 
 struct US2Function
@@ -74,39 +167,141 @@ struct US2Function
 	std::vector<s32> param_slots;
 	s32 variadic_slot = -1;
 	std::string name;
+	bool needs_env = true; // false when no closure can observe the frame (see us2_needs_environment)
+	size_t local_slots = 0; // named locals; higher slots are translator temporaries
+	size_t unoptimized_size = 0; // instruction count before optimize_us2, 0 when it did not run
+	const void* legacy_code = nullptr; // body this was translated from, matched against ManagedFunction::code_ptr
+	std::shared_ptr<US2Tables> tables; // shared between copies, like code
+	mutable const void* const* decoded_for = nullptr; // handler table the code was last decoded against
+};
+
+struct US2StackMark
+{
+	u32 segment = 0;
+	u32 used = 0;
+};
+
+// Register windows of VM2 frames, carved out of segments that never move once
+// allocated. Deep recursion adds segments instead of copying the stack, and a
+// frame's registers keep their address for the frame's whole life.
+struct US2ValueStack
+{
+	struct Segment
+	{
+		std::vector<UdonValue> slots;
+		size_t used = 0;
+	};
+	std::vector<Segment> segments;
+	size_t top = 0; // segment the next window is carved from
+
+	US2StackMark mark() const;
+	UdonValue* push(size_t count); // count None values
+	void release(const US2StackMark& to); // pops every window pushed since `to`
+	void clear();
 };
 
 struct US2Frame
 {
-	size_t base = 0;
+	UdonValue* regs = nullptr; // register window; null when env holds the slots
 	size_t size = 0;
 	size_t ip = 0;
 	const US2Function* fn = nullptr;
 	bool has_ret = false;
 	US2ValueRef ret_dst{}; // target slot in caller frame
-	UdonEnvironment* env = nullptr; // optional lexical environment for closures
+	UdonEnvironment* env = nullptr; // holds the frame's slots when closures can see them
+	UdonEnvironment* outer = nullptr; // captured environment of a closure frame, where depth 1 refs resolve
+	US2StackMark stack_mark{}; // value stack top before this frame's window
 };
 
 struct UdonInterpreter2
 {
-	std::vector<UdonValue> value_stack;
+	US2ValueStack value_stack;
 	std::vector<US2Frame> call_stack;
+	size_t max_call_depth = 100000; // frames across nested runs; deeper calls fail instead of exhausting memory
+	size_t max_nested_runs = 200; // run/call entries on the C++ stack, e.g. callbacks recursing through sort
+	size_t nested_runs = 0;
 	std::unordered_map<std::string, US2Function> functions;
+	const std::unordered_map<std::string, US2Function>* host_functions = nullptr; // shared table bound by load_from_host
+	size_t frame_floor = 0; // first call_stack entry owned by the innermost run()
+	// Call sites cache pointers into the function and builtin tables. The
+	// epoch is process-unique and changes whenever those tables may have (a
+	// new host, a host cache_version bump, register_function or reset), so a
+	// site linked by another VM or against stale tables never matches.
+	u64 link_epoch = 0;
+	const UdonInterpreter* linked_host = nullptr;
+	u64 linked_cache_version = 0;
+	bool quicken = true; // specialise arithmetic and compares on observed operand types
 
 	void register_function(const std::string& name, const US2Function& fn);
+	const US2Function* find_function(const std::string& name) const;
+	const std::unordered_map<std::string, US2Function>& function_table() const;
 	CodeLocation run(const std::string& function_name,
 		std::vector<UdonValue> args,
 		UdonValue& return_value);
+	// Runs fn on top of whatever this VM is already running; closures pass
+	// their captured environment as outer.
+	CodeLocation call(const US2Function& fn,
+		UdonEnvironment* outer,
+		const std::vector<UdonValue>& args,
+		UdonValue& return_value);
 	bool load_from_host(UdonInterpreter* host_interp, CodeLocation& err);
+	void reset();
+	void sync_link(const UdonInterpreter* host);
+	void invalidate_links();
 };
 
+// Global names are resolved to slots of `interp` while translating.
 bool compile_to_us2(
+	UdonInterpreter& interp,
 	const std::string& fn_name,
 	const std::vector<UdonInstruction>& legacy,
 	size_t legacy_frame_size,
 	US2Function& out_fn,
 	CodeLocation& err);
 
+// Escape analysis over the legacy code: true when a closure created by this
+// function (directly or through nested closures) reads or writes its locals.
+// Frames of other functions live only in registers and get no environment.
+bool us2_needs_environment(
+	const std::vector<UdonInstruction>& legacy,
+	const std::unordered_map<std::string, std::shared_ptr<std::vector<UdonInstruction>>>& code_by_name);
+
+// The translation of a script function object's body, or null when it has
+// none in table (native functions, code from another interpreter).
+const US2Function* us2_function_for(
+	const std::unordered_map<std::string, US2Function>& table,
+	const UdonValue::ManagedFunction* fn);
+
+u32 us2_add_constant(US2Function& fn, const UdonValue& v);
+// Flags calls whose result is returned straight away; VM2 runs them in the
+// caller's frame.
+void us2_mark_tail_calls(US2Function& fn);
+US2SourcePos us2_position(const US2Function& fn, size_t ip);
+
+// Constant folding, copy propagation, dead store removal, jump threading and
+// compaction over translated code. Needs needs_env to be final.
+void optimize_us2(US2Function& fn);
+
 std::string dump_us2_function(const US2Function& fn);
 
+// The generic opcode a quickened one was rewritten from (op itself otherwise).
+Opcode2 us2_generic_form(Opcode2 op);
+
+// Compiled module files (cache2.cpp): everything compile() leaves behind for
+// one source text, keyed by a hash of it and only trusted when the header
+// matches this build. Loading maps the file and copies instruction arrays out
+// in bulk; global slots are the only fix-up.
+u64 us2_source_hash(const std::string& source);
+// $UDON_CACHE_DIR, else the per-user cache directory; empty disables caching.
+std::string us2_default_cache_dir();
+std::string us2_module_path(const std::string& cache_dir, const std::string& source, bool optimized);
+// Best effort: false when the module could not be written, which only costs
+// the next run a recompile.
+bool us2_write_module(const UdonInterpreter& interp, const std::string& path, const std::string& source);
+// Restores a module into interp, which must be freshly reset. The global
+// initialisers it names (global_init_counter) have not run yet.
+bool us2_read_module(UdonInterpreter& interp, const std::string& path, const std::string& source);
+// Leading bytes of a module that must match this build and source exactly.
+size_t us2_module_header_size();
+
 const char* opcode2_name(Opcode2 op);
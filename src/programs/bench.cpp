@@ -0,0 +1,815 @@
+#include "core/udonscript.h"
+#include "core/udonscript2.h"
+#include "core/helpers.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using BenchClock = std::chrono::steady_clock;
+
+static double elapsed_ms(BenchClock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+static void report(const std::string& label, double ms, size_t iterations)
+{
+	std::cout << "  " << label << ": " << ms << " ms total, "
+			  << (ms * 1e6 / static_cast<double>(iterations)) << " ns/iter\n";
+}
+
+// Host-to-script call overhead on a script with many functions.
+static int bench_calls(size_t iterations)
+{
+	const size_t function_count = 500;
+	std::ostringstream src;
+	for (size_t i = 0; i < function_count; ++i)
+		src << "function f" << i << "(x) {\n\treturn x + " << i << "\n}\n";
+
+	UdonInterpreter interp;
+	CodeLocation res = interp.compile(src.str());
+	if (res.has_error)
+	{
+		std::cerr << "compile error: " << res.opt_error_message << "\n";
+		return 1;
+	}
+
+	std::cout << "calls: " << function_count << " functions, " << iterations << " host calls\n";
+
+	{
+		UdonInterpreter* prev = g_udon_current;
+		g_udon_current = &interp;
+		auto start = BenchClock::now();
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			UdonInterpreter2 vm;
+			for (const auto& kv : interp.functions_v2)
+				vm.register_function(kv.first, kv.second);
+			UdonValue rv;
+			vm.run("f" + std::to_string(i % function_count), { make_int(static_cast<s64>(i)) }, rv);
+		}
+		report("fresh vm per call", elapsed_ms(start), iterations);
+		g_udon_current = prev;
+	}
+
+	{
+		auto start = BenchClock::now();
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			UdonValue rv;
+			interp.run("f" + std::to_string(i % function_count), { make_int(static_cast<s64>(i)) }, rv);
+		}
+		report("persistent vm", elapsed_ms(start), iterations);
+	}
+	return 0;
+}
+
+// The chained bucket table ValueHashMap used before it became open addressing,
+// kept here as the baseline for the hashmap benchmark.
+template <typename T>
+struct LegacyBucketMap
+{
+	struct Entry
+	{
+		UdonValue key;
+		T value;
+		size_t hash;
+	};
+
+	std::vector<std::vector<Entry>> buckets = std::vector<std::vector<Entry>>(16);
+	size_t count = 0;
+
+	T* find(const UdonValue& key)
+	{
+		const size_t h = hash_value(key);
+		for (auto& entry : buckets[h % buckets.size()])
+		{
+			if (entry.hash == h && hashable_values_equal(entry.key, key))
+				return &entry.value;
+		}
+		return nullptr;
+	}
+
+	void set(const UdonValue& key, const T& value)
+	{
+		if (static_cast<double>(count + 1) > 0.75 * static_cast<double>(buckets.size()))
+		{
+			std::vector<std::vector<Entry>> new_buckets(buckets.size() * 2);
+			for (auto& bucket : buckets)
+				for (auto& entry : bucket)
+					new_buckets[entry.hash % new_buckets.size()].push_back(entry);
+			buckets.swap(new_buckets);
+		}
+		const size_t h = hash_value(key);
+		auto& bucket = buckets[h % buckets.size()];
+		for (auto& entry : bucket)
+		{
+			if (entry.hash == h && hashable_values_equal(entry.key, key))
+			{
+				entry.value = value;
+				return;
+			}
+		}
+		bucket.push_back(Entry{ key, value, h });
+		++count;
+	}
+
+	bool erase(const UdonValue& key)
+	{
+		const size_t h = hash_value(key);
+		auto& bucket = buckets[h % buckets.size()];
+		for (size_t i = 0; i < bucket.size(); ++i)
+		{
+			if (bucket[i].hash == h && hashable_values_equal(bucket[i].key, key))
+			{
+				bucket[i] = bucket.back();
+				bucket.pop_back();
+				--count;
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+template <typename Map>
+static void bench_map(const std::string& label, const std::vector<UdonValue>& keys, size_t rounds)
+{
+	double insert_ms = 0.0;
+	double lookup_ms = 0.0;
+	double erase_ms = 0.0;
+	size_t found = 0;
+	for (size_t r = 0; r < rounds; ++r)
+	{
+		Map map;
+		auto start = BenchClock::now();
+		for (size_t i = 0; i < keys.size(); ++i)
+			map.set(keys[i], i);
+		insert_ms += elapsed_ms(start);
+
+		start = BenchClock::now();
+		for (const auto& key : keys)
+			found += map.find(key) ? 1 : 0;
+		lookup_ms += elapsed_ms(start);
+
+		start = BenchClock::now();
+		for (const auto& key : keys)
+			map.erase(key);
+		erase_ms += elapsed_ms(start);
+	}
+	const size_t ops = keys.size() * rounds;
+	std::cout << "  " << label << ": insert " << (insert_ms * 1e6 / static_cast<double>(ops))
+			  << " ns/op, lookup " << (lookup_ms * 1e6 / static_cast<double>(ops))
+			  << " ns/op, erase " << (erase_ms * 1e6 / static_cast<double>(ops)) << " ns/op"
+			  << (found == ops ? "" : " (lookup miss!)") << "\n";
+}
+
+// ValueHashMap against the old chained bucket table, int and string keys. Strided
+// int keys (multiples of 65536, which share their low bits) only run on
+// ValueHashMap: the bucket table puts them all in one bucket.
+static int bench_hashmap(size_t key_count)
+{
+	const size_t rounds = 5;
+	std::vector<UdonValue> int_keys;
+	std::vector<UdonValue> strided_keys;
+	std::vector<UdonValue> string_keys;
+	int_keys.reserve(key_count);
+	strided_keys.reserve(key_count);
+	string_keys.reserve(key_count);
+	for (size_t i = 0; i < key_count; ++i)
+	{
+		int_keys.push_back(make_int(static_cast<s64>(i * 7919)));
+		strided_keys.push_back(make_int(static_cast<s64>(i) * 65536));
+		string_keys.push_back(make_string("key_" + std::to_string(i)));
+	}
+
+	std::cout << "hashmap: " << key_count << " keys x " << rounds << " rounds\n";
+	bench_map<LegacyBucketMap<size_t>>("int keys, buckets     ", int_keys, rounds);
+	bench_map<ValueHashMap<size_t>>("int keys, open addr   ", int_keys, rounds);
+	bench_map<ValueHashMap<size_t>>("strided, open addr    ", strided_keys, rounds);
+	bench_map<LegacyBucketMap<size_t>>("string keys, buckets  ", string_keys, rounds);
+	bench_map<ValueHashMap<size_t>>("string keys, open addr", string_keys, rounds);
+	return 0;
+}
+
+// Frame loop over a large long-lived table: per-frame garbage with full
+// collections only vs. nursery collections.
+static int bench_gc(size_t frames)
+{
+	const size_t world_size = 100000;
+	const char* src = R"(
+var world = []
+function init(n) {
+	for (var i = 0; i < n; i = i + 1)
+		push(world, {id: i, pos: [i, i]})
+}
+function frame(k) {
+	for (var j = 0; j < 2000; j = j + 1) {
+		var t = [j, {k: k}]
+	}
+	return len(world)
+}
+)";
+
+	std::cout << "gc: " << world_size << " long-lived rows, " << frames << " frames of 4000 temporaries\n";
+	for (bool generational : { false, true })
+	{
+		UdonInterpreter interp;
+		interp.gc_config.generational = generational;
+		CodeLocation res = interp.compile(src);
+		if (res.has_error)
+		{
+			std::cerr << "compile error: " << res.opt_error_message << "\n";
+			return 1;
+		}
+		UdonValue rv;
+		interp.run("init", { make_int(static_cast<s64>(world_size)) }, rv);
+		interp.collect_garbage();
+		interp.stats.gc_max_pause_us = 0;
+		const u64 runs_before = interp.gc_runs;
+		const u64 minor_before = interp.stats.gc_minor_runs;
+
+		double worst_frame_ms = 0.0;
+		auto start = BenchClock::now();
+		for (size_t f = 0; f < frames; ++f)
+		{
+			auto frame_start = BenchClock::now();
+			interp.run("frame", { make_int(static_cast<s64>(f)) }, rv);
+			worst_frame_ms = std::max(worst_frame_ms, elapsed_ms(frame_start));
+		}
+		const double total = elapsed_ms(start);
+		std::cout << "  " << (generational ? "generational" : "full only   ") << ": "
+				  << total << " ms total, worst frame " << worst_frame_ms << " ms, "
+				  << (interp.gc_runs - runs_before) << " collections ("
+				  << (interp.stats.gc_minor_runs - minor_before) << " minor), max pause "
+				  << (static_cast<double>(interp.stats.gc_max_pause_us) / 1000.0) << " ms\n";
+	}
+	return 0;
+}
+
+// Integer and float loop on VM2 with and without opcode quickening.
+static int bench_quicken(size_t iterations)
+{
+	const char* src = R"(
+function ints(n) {
+	var s = 0
+	for (var i = 0; i < n; i = i + 1) {
+		s = s + i * 3 - 1
+		if (s > 1000000)
+			s = s - 1000000
+	}
+	return s
+}
+function floats(n) {
+	var f = 0.5
+	var g = 0.0
+	for (var i = 0; i < n; i = i + 1) {
+		f = f * 0.999 + 0.25
+		if (f > g)
+			g = g + 0.5
+	}
+	return f
+}
+)";
+
+	std::cout << "quicken: " << iterations << " loop iterations\n";
+	UdonInterpreter interp;
+	CodeLocation res = interp.compile(src);
+	if (res.has_error)
+	{
+		std::cerr << "compile error: " << res.opt_error_message << "\n";
+		return 1;
+	}
+	UdonInterpreter* prev = g_udon_current;
+	g_udon_current = &interp;
+	for (bool quicken : { false, true })
+	{
+		UdonInterpreter2 vm;
+		vm.quicken = quicken;
+		CodeLocation err{};
+		if (!vm.load_from_host(&interp, err))
+		{
+			std::cerr << "load error: " << err.opt_error_message << "\n";
+			g_udon_current = prev;
+			return 1;
+		}
+		for (const char* fn : { "ints", "floats" })
+		{
+			UdonValue rv;
+			auto start = BenchClock::now();
+			vm.run(fn, { make_int(static_cast<s64>(iterations)) }, rv);
+			report(std::string(quicken ? "quickened " : "generic   ") + fn, elapsed_ms(start), iterations);
+		}
+	}
+	g_udon_current = prev;
+	return 0;
+}
+
+// sort with a script key function: every key is a callback from the builtin
+// into script code, on VM2 or on the stack interpreter.
+static int bench_sort(size_t elements)
+{
+	const char* src = R"(
+var data = []
+function fill(n) {
+	data = []
+	for (var i = 0; i < n; i = i + 1)
+		push(data, i * 7919 % 100003)
+}
+function sort_plain() {
+	return len(sort(data))
+}
+function sort_by_key() {
+	var scale = 3
+	var sorted = sort(data, {key: function(v) { return v * scale - 1 }})
+	return len(sorted)
+}
+)";
+
+	const size_t rounds = 3;
+	std::cout << "sort: " << elements << " elements with a key function, best of " << rounds << "\n";
+	UdonInterpreter interp;
+	CodeLocation res = interp.compile(src);
+	if (res.has_error)
+	{
+		std::cerr << "compile error: " << res.opt_error_message << "\n";
+		return 1;
+	}
+	UdonValue rv;
+	interp.run("fill", { make_int(static_cast<s64>(elements)) }, rv);
+	auto best_of = [&](const char* fn, double& best) -> bool
+	{
+		for (size_t r = 0; r < rounds; ++r)
+		{
+			auto start = BenchClock::now();
+			CodeLocation err = interp.run(fn, {}, rv);
+			const double ms = elapsed_ms(start);
+			if (err.has_error)
+			{
+				std::cerr << "run error: " << err.opt_error_message << "\n";
+				return false;
+			}
+			best = (r == 0) ? ms : std::min(best, ms);
+		}
+		return true;
+	};
+	double best = 0.0;
+	if (!best_of("sort_plain", best))
+		return 1;
+	report("no key function    ", best, elements);
+	for (bool on_vm2 : { false, true })
+	{
+		interp.vm2_callbacks = on_vm2;
+		if (!best_of("sort_by_key", best))
+			return 1;
+		report(on_vm2 ? "key on vm2         " : "key on stack interp", best, elements);
+	}
+	return 0;
+}
+
+// compile_append of many small chunks to one growing program. The rebuild
+// run drops every translation first, which is what each append cost before
+// translation became incremental.
+static int bench_append(size_t chunks)
+{
+	std::cout << "append: " << chunks << " chunks of one global and one function\n";
+	for (bool rebuild : { true, false })
+	{
+		UdonInterpreter interp;
+		CodeLocation res = interp.compile("function main() {\n\treturn 0\n}\n");
+		if (res.has_error)
+		{
+			std::cerr << "compile error: " << res.opt_error_message << "\n";
+			return 1;
+		}
+		auto start = BenchClock::now();
+		for (size_t i = 0; i < chunks; ++i)
+		{
+			std::ostringstream chunk;
+			chunk << "var g" << i << " = " << i << "\n";
+			chunk << "function f" << i << "(x) {\n\tvar y = x * 2\n\treturn y + g" << i << "\n}\n";
+			if (rebuild)
+				interp.functions_v2.clear();
+			res = interp.compile_append(chunk.str());
+			if (res.has_error)
+			{
+				std::cerr << "compile error: " << res.opt_error_message << "\n";
+				return 1;
+			}
+		}
+		const double ms = elapsed_ms(start);
+		UdonValue rv;
+		interp.run("f" + std::to_string(chunks - 1), { make_int(1) }, rv);
+		report(rebuild ? "full rebuild" : "incremental ", ms, chunks);
+	}
+	return 0;
+}
+
+// Cold start of a mid-sized script: compile() from source vs. compile_cached()
+// restoring the module written by the first run.
+static int bench_cache(size_t iterations)
+{
+	const size_t function_count = 300;
+	std::ostringstream src;
+	src << "var total = 0\n";
+	for (size_t i = 0; i < function_count; ++i)
+	{
+		src << "function f" << i << "(xs) {\n\tvar sum = 0\n\tforeach (var x in xs) {\n\t\tif (x % 2 == 0) {\n\t\t\tsum = sum + x * " << i
+			<< "\n\t\t} else {\n\t\t\tsum = sum - x\n\t\t}\n\t}\n\tvar g = function(y) {\n\t\treturn y + sum\n\t}\n\treturn g(" << i << ")\n}\n";
+	}
+	src << "function main() {\n\treturn f" << (function_count - 1) << "([1, 2, 3])\n}\n";
+	const std::string source = src.str();
+
+	const char* tmp = std::getenv("TMPDIR");
+	const std::string dir = std::string(tmp && *tmp ? tmp : "/tmp") + "/udon_bench_cache";
+	std::cout << "cache: " << function_count << " functions, " << source.size() << " bytes of source, "
+			  << iterations << " loads\n";
+	for (bool cached : { false, true })
+	{
+		if (cached)
+		{
+			UdonInterpreter warm;
+			warm.module_cache_dir = dir;
+			warm.compile_cached(source); // writes the module
+		}
+		auto start = BenchClock::now();
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			UdonInterpreter interp;
+			interp.module_cache_dir = cached ? dir : std::string();
+			CodeLocation res = interp.compile_cached(source);
+			if (res.has_error)
+			{
+				std::cerr << "compile error: " << res.opt_error_message << "\n";
+				return 1;
+			}
+		}
+		report(cached ? "module cache" : "from source ", elapsed_ms(start), iterations);
+	}
+	std::remove(us2_module_path(dir, source, true).c_str());
+	return 0;
+}
+
+// A template literal evaluated inside a render loop: every evaluation used to
+// re-parse the template.
+static int bench_templates(size_t iterations)
+{
+	const char* source =
+		"function render(n) {\n"
+		"\tvar total = 0\n"
+		"\tfor (var i = 0; i < n; i++) {\n"
+		"\t\tvar row = $jsx(<><tr class=\"row\" data-i={i}><td>{name}</td><td>{stats.hp}</td><td>{stats.mp}</td><td><a href={link}>{label}</a></td></tr></>)\n"
+		"\t\ttotal = total + length(row({i: i, name: \"n\" .. i, stats: {hp: i, mp: i * 2}, link: \"/x\", label: \"go\"}))\n"
+		"\t\tvar cell = $html(<><span>{a}</span><span>{b}</span></>)\n"
+		"\t\ttotal = total + length(cell({a: i, b: \"b\"}))\n"
+		"\t}\n"
+		"\treturn total\n"
+		"}\n";
+
+	UdonInterpreter interp;
+	CodeLocation res = interp.compile(source);
+	if (res.has_error)
+	{
+		std::cerr << "compile error: " << res.opt_error_message << "\n";
+		return 1;
+	}
+	std::cout << "templates: " << iterations << " evaluations of a $jsx and a $html literal\n";
+	auto start = BenchClock::now();
+	UdonValue rv;
+	res = interp.run("render", { make_int(static_cast<s64>(iterations)) }, rv);
+	if (res.has_error)
+	{
+		std::cerr << "runtime error: " << res.opt_error_message << "\n";
+		return 1;
+	}
+	report("render loop", elapsed_ms(start), iterations);
+	return 0;
+}
+
+// A loop dominated by small builtin calls, once through the std::function ABI
+// (arguments copied into a vector) and once through the span ABI (arguments
+// read in place from the caller's registers).
+static int bench_builtins(size_t iterations)
+{
+	const char* source =
+		"function loop(n) {\n"
+		"\tvar total = 0\n"
+		"\tvar s = \"abcdef\"\n"
+		"\tfor (var i = 0; i < n; i++) {\n"
+		"\t\ttotal = total + LEN(s) + LEN(s, i) + LEN(s, i, total)\n"
+		"\t}\n"
+		"\treturn total\n"
+		"}\n";
+
+	std::cout << "builtins: " << iterations << " iterations of three builtin calls\n";
+	for (bool span : { false, true })
+	{
+		UdonInterpreter interp;
+		if (span)
+		{
+			interp.register_function("LEN", "values:any...", "int", [](UdonInterpreter*, UdonArgs positional, UdonValue& out, CodeLocation&)
+			{
+				out = make_int(static_cast<s64>(positional.size() + positional[0].string_value().size()));
+				return true;
+			});
+		}
+		else
+		{
+			interp.register_function("LEN", "values:any...", "int", [](UdonInterpreter*, const std::vector<UdonValue>& positional, UdonValue& out, CodeLocation&)
+			{
+				out = make_int(static_cast<s64>(positional.size() + positional[0].string_value().size()));
+				return true;
+			});
+		}
+		CodeLocation res = interp.compile(source);
+		if (res.has_error)
+		{
+			std::cerr << "compile error: " << res.opt_error_message << "\n";
+			return 1;
+		}
+		auto start = BenchClock::now();
+		UdonValue rv;
+		res = interp.run("loop", { make_int(static_cast<s64>(iterations)) }, rv);
+		if (res.has_error)
+		{
+			std::cerr << "runtime error: " << res.opt_error_message << "\n";
+			return 1;
+		}
+		report(span ? "span ABI  " : "vector ABI", elapsed_ms(start), iterations);
+	}
+	return 0;
+}
+
+// Field reads and writes on object literals that share their keys.
+static int bench_props(size_t iterations)
+{
+	const char* source =
+		"function step(n) {\n"
+		"\tvar a = {x: 1, y: 2, z: 3, vx: 1, vy: 0, vz: -1}\n"
+		"\tvar b = {x: 4, y: 5, z: 6, vx: 0, vy: 1, vz: 0}\n"
+		"\tvar total = 0\n"
+		"\tfor (var i = 0; i < n; i++) {\n"
+		"\t\tvar p = a\n"
+		"\t\tif (i % 2 == 0) {\n"
+		"\t\t\tp = b\n"
+		"\t\t}\n"
+		"\t\tp:x = p:x + p:vx\n"
+		"\t\tp:y = p:y + p:vy\n"
+		"\t\tp:z = p:z + p:vz\n"
+		"\t\ttotal = total + p:x + p:y + p:z\n"
+		"\t}\n"
+		"\treturn total\n"
+		"}\n";
+
+	UdonInterpreter interp;
+	CodeLocation res = interp.compile(source);
+	if (res.has_error)
+	{
+		std::cerr << "compile error: " << res.opt_error_message << "\n";
+		return 1;
+	}
+	std::cout << "props: " << iterations << " iterations of 9 field reads and 3 field writes\n";
+	auto start = BenchClock::now();
+	UdonValue rv;
+	res = interp.run("step", { make_int(static_cast<s64>(iterations)) }, rv);
+	if (res.has_error)
+	{
+		std::cerr << "runtime error: " << res.opt_error_message << "\n";
+		return 1;
+	}
+	report("field loop", elapsed_ms(start), iterations);
+	return 0;
+}
+
+// A record-of-records dataset from JSON, read through computed keys. Keys
+// parsed from JSON and the key strings of the script are interned, so lookups
+// reuse hashes and compare pointers.
+static int bench_symbols(size_t iterations)
+{
+	const size_t record_count = 2000;
+	std::ostringstream json;
+	json << "[";
+	for (size_t i = 0; i < record_count; ++i)
+	{
+		json << (i ? "," : "") << "{\"id\":" << i << ",\"name\":\"n" << i << "\",\"score\":" << (i % 97)
+			 << ",\"level\":" << (i % 7) << ",\"team\":\"t" << (i % 5) << "\"}";
+	}
+	json << "]";
+
+	const char* source =
+		"function load(text) {\n"
+		"\treturn from_json(text)\n"
+		"}\n"
+		"function scan(rows, n) {\n"
+		"\tvar fields = [\"id\", \"score\", \"level\"]\n"
+		"\tvar total = 0\n"
+		"\tfor (var r = 0; r < n; r++) {\n"
+		"\t\tforeach (var row in rows) {\n"
+		"\t\t\tforeach (var f in fields) {\n"
+		"\t\t\t\ttotal = total + row[f]\n"
+		"\t\t\t}\n"
+		"\t\t}\n"
+		"\t}\n"
+		"\treturn total\n"
+		"}\n";
+
+	UdonInterpreter interp;
+	CodeLocation res = interp.compile(source);
+	if (res.has_error)
+	{
+		std::cerr << "compile error: " << res.opt_error_message << "\n";
+		return 1;
+	}
+	std::cout << "symbols: " << record_count << " JSON records, " << iterations << " scans of 3 computed keys\n";
+	auto start = BenchClock::now();
+	UdonValue rows;
+	res = interp.run("load", { make_string(json.str()) }, rows);
+	if (res.has_error)
+	{
+		std::cerr << "runtime error: " << res.opt_error_message << "\n";
+		return 1;
+	}
+	report("from_json ", elapsed_ms(start), 1);
+	start = BenchClock::now();
+	UdonValue rv;
+	res = interp.run("scan", { rows, make_int(static_cast<s64>(iterations)) }, rv);
+	if (res.has_error)
+	{
+		std::cerr << "runtime error: " << res.opt_error_message << "\n";
+		return 1;
+	}
+	report("key scans ", elapsed_ms(start), iterations * record_count * 3);
+	return 0;
+}
+
+// Fills a list with push and drains it with shift, front to back, then does
+// the same through unshift and pop.
+static int bench_queue(size_t iterations)
+{
+	const char* source =
+		"function drain(n) {\n"
+		"\tvar q = []\n"
+		"\tfor (var i = 0; i < n; i++) {\n"
+		"\t\tpush(q, i)\n"
+		"\t}\n"
+		"\tvar total = 0\n"
+		"\twhile (len(q) > 0) {\n"
+		"\t\ttotal = total + shift(q)\n"
+		"\t}\n"
+		"\treturn total\n"
+		"}\n"
+		"function drain_front(n) {\n"
+		"\tvar q = []\n"
+		"\tfor (var i = 0; i < n; i++) {\n"
+		"\t\tunshift(q, i)\n"
+		"\t}\n"
+		"\tvar total = 0\n"
+		"\twhile (len(q) > 0) {\n"
+		"\t\ttotal = total + pop(q)\n"
+		"\t}\n"
+		"\treturn total\n"
+		"}\n";
+
+	UdonInterpreter interp;
+	CodeLocation res = interp.compile(source);
+	if (res.has_error)
+	{
+		std::cerr << "compile error: " << res.opt_error_message << "\n";
+		return 1;
+	}
+	std::cout << "queue: " << iterations << " elements\n";
+	for (const char* fn : { "drain", "drain_front" })
+	{
+		auto start = BenchClock::now();
+		UdonValue rv;
+		res = interp.run(fn, { make_int(static_cast<s64>(iterations)) }, rv);
+		if (res.has_error)
+		{
+			std::cerr << "runtime error: " << res.opt_error_message << "\n";
+			return 1;
+		}
+		report(std::string(fn) == "drain" ? "push + shift " : "unshift + pop", elapsed_ms(start), iterations);
+	}
+	return 0;
+}
+
+static int bench_sets(size_t iterations)
+{
+	// Both versions count distinct values in a stream with many repeats. The
+	// array one is the old idiom: string keys built from the values.
+	const char* source =
+		"function with_array(n) {\n"
+		"\tvar seen = []\n"
+		"\tvar distinct = 0\n"
+		"\tfor (var i = 0; i < n; i++) {\n"
+		"\t\tvar v = (i * 7919) % 50000\n"
+		"\t\tif (seen[v] == none) {\n"
+		"\t\t\tseen[to_string(v)] = true\n"
+		"\t\t\tdistinct = distinct + 1\n"
+		"\t\t}\n"
+		"\t}\n"
+		"\treturn distinct\n"
+		"}\n"
+		"function with_set(n) {\n"
+		"\tvar seen = set()\n"
+		"\tvar distinct = 0\n"
+		"\tfor (var i = 0; i < n; i++) {\n"
+		"\t\tif (add(seen, (i * 7919) % 50000)) {\n"
+		"\t\t\tdistinct = distinct + 1\n"
+		"\t\t}\n"
+		"\t}\n"
+		"\treturn distinct\n"
+		"}\n";
+
+	UdonInterpreter interp;
+	CodeLocation res = interp.compile(source);
+	if (res.has_error)
+	{
+		std::cerr << "compile error: " << res.opt_error_message << "\n";
+		return 1;
+	}
+	std::cout << "sets: " << iterations << " values, up to 50000 distinct\n";
+	for (const char* fn : { "with_array", "with_set" })
+	{
+		auto start = BenchClock::now();
+		UdonValue rv;
+		res = interp.run(fn, { make_int(static_cast<s64>(iterations)) }, rv);
+		if (res.has_error)
+		{
+			std::cerr << "runtime error: " << res.opt_error_message << "\n";
+			return 1;
+		}
+		report(std::string(fn) == "with_array" ? "array, string keys" : "set, int keys     ", elapsed_ms(start), iterations);
+		std::cout << "    distinct: " << rv.int_value << "\n";
+	}
+	return 0;
+}
+
+static void print_usage(const char* program_name)
+{
+	std::cerr << "Usage: " << program_name << " <benchmark> [iterations]\n\n";
+	std::cerr << "Benchmarks:\n";
+	std::cerr << "  calls     host -> script call overhead (500 function script)\n";
+	std::cerr << "  hashmap   ValueHashMap vs. the old bucket table (int, strided int and string keys)\n";
+	std::cerr << "  gc        frame loop pauses, full vs. generational collection\n";
+	std::cerr << "  quicken   VM2 int/float loops, generic vs. quickened opcodes\n";
+	std::cerr << "  sort      sort with a script key function, VM2 vs. stack interpreter callbacks\n";
+	std::cerr << "  append    compile_append of small chunks, full rebuild vs. incremental translation\n";
+	std::cerr << "  cache     compile from source vs. loading the compiled module cache\n";
+	std::cerr << "  templates $jsx/$html literals evaluated in a render loop\n";
+	std::cerr << "  builtins  builtin call overhead, vector vs. span argument ABI\n";
+	std::cerr << "  props     field reads and writes on object literals\n";
+	std::cerr << "  symbols   JSON records read through computed string keys\n";
+	std::cerr << "  queue     fill and drain a list from opposite ends (1M elements)\n";
+	std::cerr << "  sets      distinct-value counting, array with string keys vs. Set\n";
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	const std::string which = argv[1];
+	size_t iterations = 0;
+	if (argc >= 3)
+		iterations = static_cast<size_t>(std::stoull(argv[2]));
+
+	if (which == "calls")
+		return bench_calls(iterations ? iterations : 20000);
+	if (which == "hashmap")
+		return bench_hashmap(iterations ? iterations : 200000);
+	if (which == "gc")
+		return bench_gc(iterations ? iterations : 300);
+	if (which == "quicken")
+		return bench_quicken(iterations ? iterations : 2000000);
+	if (which == "sort")
+		return bench_sort(iterations ? iterations : 100000);
+	if (which == "append")
+		return bench_append(iterations ? iterations : 1000);
+	if (which == "cache")
+		return bench_cache(iterations ? iterations : 200);
+	if (which == "templates")
+		return bench_templates(iterations ? iterations : 20000);
+	if (which == "builtins")
+		return bench_builtins(iterations ? iterations : 1000000);
+	if (which == "props")
+		return bench_props(iterations ? iterations : 1000000);
+	if (which == "symbols")
+		return bench_symbols(iterations ? iterations : 100);
+	if (which == "queue")
+		return bench_queue(iterations ? iterations : 1000000);
+	if (which == "sets")
+		return bench_sets(iterations ? iterations : 1000000);
+
+	print_usage(argv[0]);
+	return 1;
+}
@@ -47,19 +47,26 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
+	const auto& table = vm.function_table();
 	std::vector<std::string> names;
-	names.reserve(vm.functions.size());
-	for (const auto& kv : vm.functions)
+	names.reserve(table.size());
+	for (const auto& kv : table)
 		names.push_back(kv.first);
 	std::sort(names.begin(), names.end());
 
+	size_t total = 0;
+	size_t total_unoptimized = 0;
 	for (const auto& name : names)
 	{
-		auto it = vm.functions.find(name);
-		if (it == vm.functions.end())
+		const US2Function* fn = vm.find_function(name);
+		if (!fn)
 			continue;
-		std::cout << dump_us2_function(it->second) << "\n";
+		std::cout << dump_us2_function(*fn) << "\n";
+		const size_t size = fn->code ? fn->code->size() : 0;
+		total += size;
+		total_unoptimized += fn->unoptimized_size ? fn->unoptimized_size : size;
 	}
+	std::cout << "total: " << total << " instructions, " << total_unoptimized << " before optimisation\n";
 
 	return 0;
 }
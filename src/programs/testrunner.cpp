@@ -12,6 +12,8 @@
 #include <chrono>
 #include <thread>
 #include <cstring>
+#include <cstdlib>
+#include <unistd.h>
 
 struct TestCase
 {
@@ -60,7 +62,120 @@ std::vector<std::string> list_files(const std::string& directory, const std::str
 	return files;
 }
 
-bool run_test(const TestCase& test, bool dump_us2, std::string& actual_output, std::string& error_msg, std::chrono::milliseconds timeout)
+// Modules cached by an earlier build must never answer for the current one,
+// so by default every run starts from an empty directory of its own.
+std::string make_run_dir()
+{
+#ifdef _WIN32
+	return "";
+#else
+	char path[] = "/tmp/udon-testrunner-XXXXXX";
+	return mkdtemp(path) ? path : "";
+#endif
+}
+
+void remove_run_dir(const std::string& directory)
+{
+	if (directory.empty())
+		return;
+	for (const auto& name : list_files(directory, ""))
+		std::remove((directory + "/" + name).c_str());
+	rmdir(directory.c_str());
+}
+
+bool save_file(const std::string& path, const std::string& data)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file << data;
+	return static_cast<bool>(file);
+}
+
+// A module must only load into the build and source it was written for:
+// altering any header byte (version, build id, source hash...) or cutting
+// the file short has to be refused, and damage past the header must not crash.
+bool check_module_cache(const std::string& directory, std::string& error_msg)
+{
+	const std::string source =
+		"var base = 40\n"
+		"function add(a, b)\n{\n\treturn a + b\n}\n"
+		"function main()\n{\n\tprint(add(base, 2), [1, 2, 3], {k: \"v\"})\n}\n";
+
+	UdonInterpreter writer;
+	if (writer.compile(source).has_error)
+	{
+		error_msg = "Failed to compile the module source";
+		return false;
+	}
+	const std::string path = us2_module_path(directory, source, writer.optimize_us2);
+	if (!us2_write_module(writer, path, source))
+	{
+		error_msg = "Failed to write " + path;
+		return false;
+	}
+	const std::string module = load_file(path);
+
+	auto loads = [&](const std::string& data)
+	{
+		UdonInterpreter reader;
+		return save_file(path, data) && us2_read_module(reader, path, source);
+	};
+
+	if (!loads(module))
+	{
+		error_msg = "A freshly written module was rejected";
+		return false;
+	}
+	const size_t header_size = us2_module_header_size();
+	for (size_t i = 0; i < header_size && i < module.size(); ++i)
+	{
+		std::string stale = module;
+		stale[i] = static_cast<char>(stale[i] ^ 0x5a);
+		if (loads(stale))
+		{
+			error_msg = "A module with header byte " + std::to_string(i) + " altered was accepted";
+			return false;
+		}
+	}
+	for (size_t size = 0; size < module.size(); size += 1 + size / 4)
+	{
+		if (loads(module.substr(0, size)))
+		{
+			error_msg = "A module cut to " + std::to_string(size) + " bytes was accepted";
+			return false;
+		}
+	}
+	for (size_t i = header_size; i < module.size(); i += 3)
+	{
+		std::string damaged = module;
+		damaged[i] = static_cast<char>(~damaged[i]);
+		loads(damaged);
+	}
+	std::remove(path.c_str());
+	return true;
+}
+
+// A line reading "// @append" starts a new chunk: the first chunk is compiled
+// and every later one goes through compile_append, as a host adding code would.
+std::vector<std::string> split_chunks(const std::string& script)
+{
+	std::vector<std::string> chunks(1);
+	std::istringstream in(script);
+	std::string line;
+	while (std::getline(in, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (line == "// @append")
+		{
+			chunks.emplace_back();
+			continue;
+		}
+		chunks.back() += line + "\n";
+	}
+	return chunks;
+}
+
+bool run_test(const TestCase& test, bool dump_us2, const std::string& cache_dir, std::string& actual_output, std::string& error_msg, std::chrono::milliseconds timeout)
 {
 	auto task = [&]() -> bool
 	{
@@ -68,6 +183,7 @@ bool run_test(const TestCase& test, bool dump_us2, std::string& actual_output, s
 		std::streambuf* old_cout = std::cout.rdbuf(captured.rdbuf());
 
 		UdonInterpreter interp;
+		interp.module_cache_dir = cache_dir;
 
 		std::string script = load_file(test.script_path);
 		if (script.empty())
@@ -77,7 +193,10 @@ bool run_test(const TestCase& test, bool dump_us2, std::string& actual_output, s
 			return false;
 		}
 
-		CodeLocation compile_result = interp.compile(script);
+		const std::vector<std::string> chunks = split_chunks(script);
+		CodeLocation compile_result = interp.compile_cached(chunks[0]);
+		for (size_t i = 1; i < chunks.size() && !compile_result.has_error; ++i)
+			compile_result = interp.compile_append(chunks[i]);
 
 		if (compile_result.has_error)
 		{
@@ -101,9 +220,8 @@ bool run_test(const TestCase& test, bool dump_us2, std::string& actual_output, s
 			CodeLocation err{};
 			if (vm.load_from_host(&interp, err))
 			{
-				auto it = vm.functions.find("main");
-				if (it != vm.functions.end())
-					std::cout << dump_us2_function(it->second) << "\n";
+				if (const US2Function* main_fn = vm.find_function("main"))
+					std::cout << dump_us2_function(*main_fn) << "\n";
 			}
 			std::cout.rdbuf(captured.rdbuf());
 		}
@@ -147,6 +265,9 @@ int main(int argc, char* argv[])
 {
 	std::string test_dir = "scripts/testsuite";
 	bool dump_us2 = false;
+	const std::string run_dir = make_run_dir();
+	// An explicit UDON_CACHE_DIR is honoured (empty disables caching).
+	std::string cache_dir = std::getenv("UDON_CACHE_DIR") ? us2_default_cache_dir() : run_dir;
 	std::chrono::milliseconds timeout(5000);
 
 	for (int i = 1; i < argc; ++i)
@@ -157,6 +278,11 @@ int main(int argc, char* argv[])
 			dump_us2 = true;
 			continue;
 		}
+		if (arg == "--no-cache")
+		{
+			cache_dir.clear();
+			continue;
+		}
 		if (arg.rfind("--timeout=", 0) == 0)
 		{
 			int ms = std::stoi(arg.substr(strlen("--timeout=")));
@@ -217,7 +343,18 @@ int main(int argc, char* argv[])
 		std::string actual_output;
 		std::string error_msg;
 
-		bool ran_ok = run_test(test, dump_us2, actual_output, error_msg, timeout);
+		bool ran_ok = run_test(test, dump_us2, cache_dir, actual_output, error_msg, timeout);
+		if (ran_ok && !cache_dir.empty())
+		{
+			// Again from the module the first run left behind.
+			std::string cached_output;
+			ran_ok = run_test(test, false, cache_dir, cached_output, error_msg, timeout);
+			if (ran_ok && cached_output != actual_output)
+			{
+				ran_ok = false;
+				error_msg = "Output changed when loaded from the module cache:\n" + cached_output;
+			}
+		}
 
 		if (!ran_ok)
 		{
@@ -250,9 +387,28 @@ int main(int argc, char* argv[])
 		}
 	}
 
+	if (!run_dir.empty())
+	{
+		std::string error_msg;
+		if (check_module_cache(run_dir, error_msg))
+		{
+			std::cout << "[PASS] module_cache\n";
+			passed++;
+		}
+		else
+		{
+			std::cout << "[FAIL] module_cache\n";
+			report_file << "=== module_cache ===\n";
+			report_file << "ERROR: " << error_msg << "\n\n";
+			failed++;
+			failed_tests.push_back("module_cache");
+		}
+	}
+	remove_run_dir(run_dir);
+
 	std::cout << "\n";
 	std::cout << "======================\n";
-	std::cout << "Results: " << passed << " passed, " << failed << " failed out of " << tests.size() << " tests\n";
+	std::cout << "Results: " << passed << " passed, " << failed << " failed out of " << passed + failed << " tests\n";
 
 	if (!failed_tests.empty())
 	{
@@ -1,5 +1,6 @@
 #include "core/udonscript.h"
 #include "core/helpers.h"
+#include "core/udonscript2.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -55,8 +56,9 @@ int main(int argc, char* argv[])
 	}
 
 	UdonInterpreter interp;
+	interp.module_cache_dir = us2_default_cache_dir();
 
-	CodeLocation compile_result = interp.compile(script_content);
+	CodeLocation compile_result = interp.compile_cached(script_content);
 
 	if (compile_result.has_error)
 	{
@@ -0,0 +1 @@
+#define UDON_BUILD_ID 2730336725ull